@@ -0,0 +1,151 @@
+#!/usr/bin/env python3
+"""
+Stand-in receiver for the SMLReader stream output.
+
+Groups the received lines into messages (one message per sensor and
+uptime) and prints for every message its latency, which is the time
+between decoding the message on SMLReader and receiving it here.
+
+To relate the uptime of SMLReader to the local clock, the receiver sends
+a ping every few seconds and keeps the answer with the shortest round
+trip (like NTP does). The latency is thus accurate to half of that round
+trip time, which is printed as well.
+
+Usage:
+    receiver.py udp <smlreader_host> [multicast_address] [port]
+    receiver.py tcp <smlreader_host> [port]
+"""
+import select
+import socket
+import struct
+import sys
+import time
+
+DEFAULT_MULTICAST_ADDRESS = "239.12.34.56"
+DEFAULT_PORT = 5432
+PING_INTERVAL = 5
+# Lines of a message arriving in several TCP segments are considered complete after this idle time
+FLUSH_TIMEOUT = 0.05
+
+
+def now_ms():
+    return time.monotonic() * 1000
+
+
+class Clock:
+    """Offset between the uptime of SMLReader and the local clock"""
+
+    def __init__(self):
+        self.offset = None
+        self.rtt = None
+        self.pending = {}
+        self.token = 0
+
+    def ping(self):
+        self.token += 1
+        self.pending[str(self.token)] = now_ms()
+        return ("ping;%d\n" % self.token).encode("utf-8")
+
+    def pong(self, line, received):
+        _, token, device_millis = line.split(";")
+        sent = self.pending.pop(token, None)
+        if sent is None:
+            return
+        rtt = received - sent
+        if self.rtt is None or rtt <= self.rtt:
+            self.rtt = rtt
+            self.offset = (sent + received) / 2 - int(device_millis)
+
+    def latency(self, device_millis, received):
+        if self.offset is None:
+            return None
+        return received - (device_millis + self.offset)
+
+
+class Receiver:
+    def __init__(self, clock):
+        self.clock = clock
+        self.buffer = ""
+        self.message = None  # (sensor, device millis, first received, lines)
+
+    def feed(self, data, received):
+        self.buffer += data.decode("utf-8", "replace")
+        *lines, self.buffer = self.buffer.split("\n")
+        for line in lines:
+            if not line:
+                continue
+            if line.startswith("pong;"):
+                self.clock.pong(line, received)
+                continue
+            fields = line.split(";")
+            if len(fields) < 4:
+                print("Skipping malformed line: %s" % line)
+                continue
+            key = (fields[0], int(fields[1]))
+            if self.message is not None and self.message[:2] != key:
+                self.flush()
+            if self.message is None:
+                self.message = (key[0], key[1], received, [])
+            self.message[3].append(line)
+
+    def flush(self):
+        if self.message is None:
+            return
+        sensor, device_millis, received, lines = self.message
+        self.message = None
+        latency = self.clock.latency(device_millis, received)
+        if latency is None:
+            print("sensor %s: %d values, latency unknown (waiting for pong)" % (sensor, len(lines)))
+        else:
+            print("sensor %s: %d values, latency %.1f ms (+/- %.1f ms)" % (sensor, len(lines), latency, self.clock.rtt / 2))
+        for line in lines:
+            print("  " + line)
+
+
+def run(sock, send_ping):
+    clock = Clock()
+    receiver = Receiver(clock)
+    next_ping = 0
+    while True:
+        if time.monotonic() >= next_ping:
+            send_ping(clock.ping())
+            next_ping = time.monotonic() + PING_INTERVAL
+        readable, _, _ = select.select([sock], [], [], FLUSH_TIMEOUT)
+        if not readable:
+            receiver.flush()
+            continue
+        data = sock.recv(2048)
+        if not data:
+            break
+        receiver.feed(data, now_ms())
+        if sock.type == socket.SOCK_DGRAM:
+            # Every datagram is a complete message
+            receiver.flush()
+    receiver.flush()
+
+
+def listen_udp(host, address, port):
+    sock = socket.socket(socket.AF_INET, socket.SOCK_DGRAM, socket.IPPROTO_UDP)
+    sock.setsockopt(socket.SOL_SOCKET, socket.SO_REUSEADDR, 1)
+    sock.bind(("", port))
+    membership = struct.pack("4sl", socket.inet_aton(address), socket.INADDR_ANY)
+    sock.setsockopt(socket.IPPROTO_IP, socket.IP_ADD_MEMBERSHIP, membership)
+    run(sock, lambda ping: sock.sendto(ping, (host, port)))
+
+
+def listen_tcp(host, port):
+    sock = socket.create_connection((host, port))
+    sock.setsockopt(socket.IPPROTO_TCP, socket.TCP_NODELAY, 1)
+    run(sock, sock.sendall)
+
+
+if __name__ == "__main__":
+    if len(sys.argv) < 3 or sys.argv[1] not in ("udp", "tcp"):
+        print(__doc__)
+        sys.exit(1)
+    if sys.argv[1] == "udp":
+        listen_udp(sys.argv[2],
+                   sys.argv[3] if len(sys.argv) > 3 else DEFAULT_MULTICAST_ADDRESS,
+                   int(sys.argv[4]) if len(sys.argv) > 4 else DEFAULT_PORT)
+    else:
+        listen_tcp(sys.argv[2], int(sys.argv[3]) if len(sys.argv) > 3 else DEFAULT_PORT)
@@ -0,0 +1,19 @@
+# Creates a gzip compressed copy of the firmware image after building.
+# Since ESP8266 Arduino core 2.7.0 the bootloader is able to decompress
+# OTA updates itself, so uploading firmware.bin.gz via the update page
+# transfers considerably less data than the uncompressed image.
+
+import gzip
+import shutil
+
+Import("env")
+
+
+def compress_firmware(source, target, env):
+    firmware = str(target[0])
+    with open(firmware, "rb") as src, gzip.open(firmware + ".gz", "wb", compresslevel=9) as dst:
+        shutil.copyfileobj(src, dst)
+    print("Compressed firmware written to %s.gz" % firmware)
+
+
+env.AddPostAction("$BUILD_DIR/${PROGNAME}.bin", compress_firmware)
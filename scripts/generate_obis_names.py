@@ -0,0 +1,126 @@
+#!/usr/bin/env python3
+# Generates src/obis.h, a perfect hash table mapping OBIS codes of electricity
+# meters to human-readable names. Run it again after modifying OBIS_NAMES.
+
+import os
+
+# (C, D, E), name
+OBIS_NAMES = [
+    ((0, 0, 9), "Device ID"),
+    ((0, 2, 0), "Firmware version"),
+    ((1, 8, 0), "Active energy import"),
+    ((1, 8, 1), "Active energy import tariff 1"),
+    ((1, 8, 2), "Active energy import tariff 2"),
+    ((2, 8, 0), "Active energy export"),
+    ((2, 8, 1), "Active energy export tariff 1"),
+    ((2, 8, 2), "Active energy export tariff 2"),
+    ((3, 8, 0), "Reactive energy import"),
+    ((4, 8, 0), "Reactive energy export"),
+    ((13, 7, 0), "Power factor"),
+    ((14, 7, 0), "Frequency"),
+    ((16, 7, 0), "Active power"),
+    ((31, 7, 0), "Current L1"),
+    ((32, 7, 0), "Voltage L1"),
+    ((36, 7, 0), "Active power L1"),
+    ((51, 7, 0), "Current L2"),
+    ((52, 7, 0), "Voltage L2"),
+    ((56, 7, 0), "Active power L2"),
+    ((71, 7, 0), "Current L3"),
+    ((72, 7, 0), "Voltage L3"),
+    ((76, 7, 0), "Active power L3"),
+    ((81, 7, 1), "Phase angle U-L2/U-L1"),
+    ((81, 7, 2), "Phase angle U-L3/U-L1"),
+    ((81, 7, 4), "Phase angle I-L1/U-L1"),
+    ((81, 7, 15), "Phase angle I-L2/U-L2"),
+    ((81, 7, 26), "Phase angle I-L3/U-L3"),
+    ((96, 1, 0), "Server ID"),
+    ((96, 5, 0), "Operating status"),
+    ((96, 50, 1), "Manufacturer"),
+    ((96, 90, 2), "Firmware checksum"),
+]
+
+TARGET = os.path.join(os.path.dirname(os.path.abspath(__file__)), "..", "src", "obis.h")
+
+
+def find_hash():
+    # Smallest table size with hash(C, D, E) = (C * a + D * b + E) % size being collision free
+    for size in range(len(OBIS_NAMES), 256):
+        for a in range(1, 64):
+            for b in range(1, 64):
+                slots = {(c * a + d * b + e) % size for (c, d, e), _ in OBIS_NAMES}
+                if len(slots) == len(OBIS_NAMES):
+                    return size, a, b
+    raise Exception("No perfect hash found")
+
+
+def main():
+    size, a, b = find_hash()
+    max_length = max(len(name.encode("utf-8")) for _, name in OBIS_NAMES) + 1
+    table = [None] * size
+    for (c, d, e), name in OBIS_NAMES:
+        table[(c * a + d * b + e) % size] = ((c, d, e), name)
+
+    lines = []
+    for slot, item in enumerate(table):
+        if item is None:
+            lines.append("    {0, 0, 0, \"\"}, // %d" % slot)
+        else:
+            (c, d, e), name = item
+            lines.append("    {%d, %d, %d, \"%s\"}, // %d" % (c, d, e, name, slot))
+
+    with open(TARGET, "w") as f:
+        f.write("""// Generated by scripts/generate_obis_names.py, do not edit.
+
+#ifndef OBIS_H
+#define OBIS_H
+
+#include <Arduino.h>
+
+#define OBIS_NAME_MAX_LENGTH %(max_length)d
+#define OBIS_NAMES_SIZE %(size)d
+
+typedef struct
+{
+    unsigned char c;
+    unsigned char d;
+    unsigned char e;
+    char name[OBIS_NAME_MAX_LENGTH];
+} obis_name_t;
+
+// Perfect hash of the C, D and E groups of an OBIS code
+constexpr unsigned int obis_hash(unsigned char c, unsigned char d, unsigned char e)
+{
+    return (c * %(a)du + d * %(b)du + e) %% OBIS_NAMES_SIZE;
+}
+
+/**
+ * Static lookup table, indexed by obis_hash()
+ */
+static const obis_name_t obis_names[OBIS_NAMES_SIZE] PROGMEM = {
+%(lines)s
+};
+
+// Copies the name of an electricity related OBIS code (A = 1) to the buffer, returns false if it is unknown
+bool obis_get_name(const unsigned char *obj_name, char *buffer, size_t size)
+{
+    if (obj_name[0] != 1)
+    {
+        return false;
+    }
+    const obis_name_t *it = &obis_names[obis_hash(obj_name[2], obj_name[3], obj_name[4])];
+    if (pgm_read_byte(&it->c) != obj_name[2] || pgm_read_byte(&it->d) != obj_name[3] ||
+        pgm_read_byte(&it->e) != obj_name[4] || pgm_read_byte(&it->name[0]) == 0)
+    {
+        return false;
+    }
+    strncpy_P(buffer, it->name, size - 1);
+    buffer[size - 1] = '\\0';
+    return true;
+}
+
+#endif
+""" % {"max_length": max_length, "size": size, "a": a, "b": b, "lines": "\n".join(lines)})
+
+
+if __name__ == "__main__":
+    main()
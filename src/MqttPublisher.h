@@ -3,9 +3,11 @@
 
 #include "config.h"
 #include "debug.h"
+#include "format.h"
 #include <Ticker.h>
 
 #include <AsyncMqttClient.h>
+#include <list>
 #include <string.h>
 #include <sml/sml_file.h>
 
@@ -15,6 +17,13 @@
 #define MQTT_LWT_QOS 2
 #define MQTT_LWT_PAYLOAD_ONLINE "Online"
 #define MQTT_LWT_PAYLOAD_OFFLINE "Offline"
+#define MQTT_MAX_TOPIC_LENGTH 256
+#define MQTT_MAX_PAYLOAD_LENGTH 255
+#define MQTT_HEARTBEAT_INTERVAL 60
+#define MQTT_HEARTBEAT_MAX_PAYLOAD_LENGTH 768
+#define MQTT_RAW_HEADER_LENGTH 5
+// PackBits needs one additional byte per 128 literal bytes in the worst case
+#define MQTT_RAW_MAX_PAYLOAD_LENGTH (MQTT_RAW_HEADER_LENGTH + BUFFER_SIZE + (BUFFER_SIZE / 128) + 1)
 
 using namespace std;
 
@@ -33,16 +42,16 @@ public:
   void setup(MqttConfig _config)
   {
     config = _config;
-    uint8_t lastCharOfTopic = strlen(config.topic) - 1;
-    baseTopic = String(config.topic) + (lastCharOfTopic >= 0 && config.topic[lastCharOfTopic] == '/' ? "" : "/");
-    lastWillTopic = String(baseTopic + MQTT_LWT_TOPIC);
+    size_t topicLength = strlen(config.topic);
+    snprintf(baseTopic, sizeof(baseTopic), "%s%s", config.topic, (topicLength > 0 && config.topic[topicLength - 1] == '/') ? "" : "/");
+    snprintf(lastWillTopic, sizeof(lastWillTopic), "%s%s", baseTopic, MQTT_LWT_TOPIC);
 
     DEBUG(F("MQTT: Setting up..."));
     DEBUG(F("MQTT: Server: %s"),config.server);
     DEBUG(F("MQTT: Port: %d"),atoi(config.port));
     DEBUG(F("MQTT: Username: %s"),config.username);
     DEBUG(F("MQTT: Password: <hidden>"));
-    DEBUG(F("MQTT: Topic: %s"), baseTopic.c_str());
+    DEBUG(F("MQTT: Topic: %s"), baseTopic);
     
     client.setServer(const_cast<const char *>(config.server), atoi(config.port));
     if (strlen(config.username) > 0 || strlen(config.password) > 0)
@@ -50,20 +59,78 @@ public:
       client.setCredentials(config.username, config.password);
     }
     client.setCleanSession(true);
-    client.setWill(lastWillTopic.c_str(), MQTT_LWT_QOS, MQTT_LWT_RETAIN, MQTT_LWT_PAYLOAD_OFFLINE);
+    client.setWill(lastWillTopic, MQTT_LWT_QOS, MQTT_LWT_RETAIN, MQTT_LWT_PAYLOAD_OFFLINE);
     client.setKeepAlive(MQTT_RECONNECT_DELAY * 3);
     this->registerHandlers();
+
+    // Only reserve memory for raw messages if they are going to be published
+    for (uint8_t i = 0; i < NUM_OF_SENSORS && rawPayload == NULL; i++)
+    {
+      if (SENSOR_CONFIGS[i].raw != RAW_NONE)
+      {
+        rawPayload = new uint8_t[MQTT_RAW_MAX_PAYLOAD_LENGTH];
+      }
+    }
   
   }
 
+  bool isConnected()
+  {
+    return this->connected;
+  }
+
   void debug(const char *message)
   {
-    publish(baseTopic + "debug", message);
+    publishToSubtopic("debug", message);
   }
 
   void info(const char *message)
   {
-    publish(baseTopic + "info", message);
+    publishToSubtopic("info", message);
+  }
+
+  void snapshot(const char *payload)
+  {
+    publishToSubtopic("snapshot", payload);
+  }
+
+  // Publishes the health of the device and its sensors as compact JSON to the info topic
+  void heartbeat(std::list<Sensor *> *sensors, unsigned long loopMaxDuration, uint32_t snapshotDrops)
+  {
+    if (!this->connected)
+    {
+      return;
+    }
+
+    unsigned long now = millis();
+    size_t pos = snprintf(heartbeatPayload, sizeof(heartbeatPayload),
+                          "{\"uptime\":%lu,\"heap\":%u,\"block\":%u,\"rssi\":%d,\"loop_max\":%lu,\"publish_failures\":%u,\"snapshot_drops\":%u,\"sensors\":{",
+                          (unsigned long)(millis64() / 1000), ESP.getFreeHeap(), ESP.getMaxFreeBlockSize(), WiFi.RSSI(), loopMaxDuration,
+                          publishFailures, snapshotDrops);
+    for (std::list<Sensor *>::iterator it = sensors->begin(); it != sensors->end() && pos < sizeof(heartbeatPayload); ++it)
+    {
+      const SensorMetrics &metrics = (*it)->get_metrics();
+      char age[12] = "null";
+      if (metrics.frames > 0)
+      {
+        snprintf(age, sizeof(age), "%lu", now - metrics.last_frame);
+      }
+      pos += snprintf(heartbeatPayload + pos, sizeof(heartbeatPayload) - pos,
+                      "%s\"%s\":{\"age\":%s,\"frames\":%u,\"crc_errors\":%u,\"malformed\":%u,\"overflows\":%u,\"timeouts\":%u,\"serial_overflows\":%u,\"serial_peak\":%u,\"process_max\":%lu}",
+                      it == sensors->begin() ? "" : ",", (*it)->config->name, age,
+                      metrics.frames, metrics.crc_errors, metrics.malformed, metrics.overflows, metrics.timeouts,
+                      metrics.serial_overflows, metrics.serial_peak, metrics.process_max);
+    }
+    if (pos < sizeof(heartbeatPayload))
+    {
+      pos += snprintf(heartbeatPayload + pos, sizeof(heartbeatPayload) - pos, "}}");
+    }
+    if (pos >= sizeof(heartbeatPayload))
+    {
+      DEBUG(F("MQTT: Heartbeat payload size exceeded, skipping heartbeat."));
+      return;
+    }
+    publishToSubtopic("info", heartbeatPayload);
   }
 
   void publish(Sensor *sensor, sml_file *file)
@@ -72,59 +139,66 @@ public:
     for (int i = 0; i < file->messages_len; i++)
     {
       sml_message *message = file->messages[i];
-      if (*message->message_body->tag == SML_MESSAGE_GET_LIST_RESPONSE)
+      if (is_get_list_response(message))
       {
         sml_list *entry;
         sml_get_list_response *body;
         body = (sml_get_list_response *)message->message_body->data;
         for (entry = body->val_list; entry != NULL; entry = entry->next)
         {
-          if (!entry->value)
-          { // do not crash on null value
-            continue;
-          }
-
           char obisIdentifier[32];
-          char buffer[255];
-
-          sprintf(obisIdentifier, "%d-%d:%d.%d.%d/%d",
-                  entry->obj_name->str[0], entry->obj_name->str[1],
-                  entry->obj_name->str[2], entry->obj_name->str[3],
-                  entry->obj_name->str[4], entry->obj_name->str[5]);
-
-          String entryTopic = baseTopic + "sensor/" + (sensor->config->name) + "/obis/" + obisIdentifier + "/";
+          char buffer[MQTT_MAX_PAYLOAD_LENGTH];
 
-          if (((entry->value->type & SML_TYPE_FIELD) == SML_TYPE_INTEGER) ||
-              ((entry->value->type & SML_TYPE_FIELD) == SML_TYPE_UNSIGNED))
+          if (!format_obis(entry, obisIdentifier, sizeof(obisIdentifier)) ||
+              !format_value(entry, sensor->config->numeric_only, buffer, sizeof(buffer)))
           {
-            double value = sml_value_to_double(entry->value);
-            int scaler = (entry->scaler) ? *entry->scaler : 0;
-            int prec = -scaler;
-            if (prec < 0)
-              prec = 0;
-            value = value * pow(10, scaler);
-            sprintf(buffer, "%.*f", prec, value);
-            publish(entryTopic + "value", buffer);
-          }
-          else if (!sensor->config->numeric_only)
-          {
-            if (entry->value->type == SML_TYPE_OCTET_STRING)
-            {
-              char *value;
-              sml_value_to_strhex(entry->value, &value, true);
-              publish(entryTopic + "value", value);
-              free(value);
-            }
-            else if (entry->value->type == SML_TYPE_BOOLEAN)
-            {
-              publish(entryTopic + "value", entry->value->data.boolean ? "true" : "false");
-            }
+            continue;
           }
+
+          char entryTopic[MQTT_MAX_TOPIC_LENGTH];
+          snprintf(entryTopic, sizeof(entryTopic), "%ssensor/%s/obis/%s/value", baseTopic, sensor->config->name, obisIdentifier);
+          publish(entryTopic, buffer);
         }
       }
     }
   }
 
+  // Publishes the verified message as is, prefixed by the encoding (1 byte) and a sequence number (4 bytes, big endian)
+  void publishRaw(Sensor *sensor, const byte *buffer, size_t len)
+  {
+    if (!this->connected || rawPayload == NULL)
+    {
+      return;
+    }
+
+    uint32_t sequence = sensor->get_metrics().started;
+    size_t pos = 0;
+    rawPayload[pos++] = sensor->config->raw;
+    rawPayload[pos++] = (sequence >> 24) & 0xFF;
+    rawPayload[pos++] = (sequence >> 16) & 0xFF;
+    rawPayload[pos++] = (sequence >> 8) & 0xFF;
+    rawPayload[pos++] = sequence & 0xFF;
+
+    if (sensor->config->raw == RAW_PACKBITS)
+    {
+      pos += packBits(buffer, len, rawPayload + pos);
+    }
+    else
+    {
+      memcpy(rawPayload + pos, buffer, len);
+      pos += len;
+    }
+
+    char topic[MQTT_MAX_TOPIC_LENGTH];
+    snprintf(topic, sizeof(topic), "%ssensor/%s/raw", baseTopic, sensor->config->name);
+    DEBUG(F("MQTT: Publishing %d bytes of raw data to %s."), pos, topic);
+    if (client.publish(topic, 0, false, (const char *)rawPayload, pos) == 0)
+    {
+      DEBUG(F("MQTT: Publishing raw data failed."));
+      publishFailures++;
+    }
+  }
+
   void connect()
   {
     if (this->connected)
@@ -153,20 +227,51 @@ private:
   MqttConfig config;
   AsyncMqttClient client;
   Ticker reconnectTimer;
-  String baseTopic;
-  String lastWillTopic;
+  char baseTopic[sizeof(MqttConfig::topic) + 1] = "";
+  char lastWillTopic[sizeof(MqttConfig::topic) + sizeof(MQTT_LWT_TOPIC) + 1] = "";
+  uint8_t *rawPayload = NULL;
+  uint32_t publishFailures = 0;
+  char heartbeatPayload[MQTT_HEARTBEAT_MAX_PAYLOAD_LENGTH];
 
-  void publish(const String &topic, const String &payload, uint8_t qos=0, bool retain=false)
-  {
-    publish(topic.c_str(), payload.c_str(), qos, retain);
-  }
-  void publish(String &topic, const char *payload, uint8_t qos=0, bool retain=false)
+  // Compresses the data using PackBits run-length encoding, returns the number of bytes written
+  static size_t packBits(const byte *data, size_t len, uint8_t *out)
   {
-    publish(topic.c_str(), payload, qos, retain);
+    size_t in = 0;
+    size_t pos = 0;
+    while (in < len)
+    {
+      size_t run = 1;
+      while ((in + run) < len && run < 128 && data[in + run] == data[in])
+      {
+        run++;
+      }
+      if (run > 1)
+      {
+        out[pos++] = (uint8_t)(257 - run);
+        out[pos++] = data[in];
+        in += run;
+        continue;
+      }
+      // Collect literals until the next run of at least 3 equal bytes
+      size_t literals = 1;
+      while ((in + literals) < len && literals < 128 &&
+             !((in + literals + 2) < len && data[in + literals] == data[in + literals + 1] && data[in + literals] == data[in + literals + 2]))
+      {
+        literals++;
+      }
+      out[pos++] = (uint8_t)(literals - 1);
+      memcpy(out + pos, data + in, literals);
+      pos += literals;
+      in += literals;
+    }
+    return pos;
   }
-  void publish(const char *topic, const String &payload, uint8_t qos=0, bool retain=false)
+
+  void publishToSubtopic(const char *subtopic, const char *payload, uint8_t qos=0, bool retain=false)
   {
-    publish(topic, payload.c_str(), qos, retain);
+    char topic[MQTT_MAX_TOPIC_LENGTH];
+    snprintf(topic, sizeof(topic), "%s%s", baseTopic, subtopic);
+    publish(topic, payload, qos, retain);
   }
 
 
@@ -176,7 +281,11 @@ private:
     {
       DEBUG(F("MQTT: Publishing to %s:"), topic);
       DEBUG(F("%s\n"), payload);
-      client.publish(topic, qos, retain, payload, strlen(payload));
+      if (client.publish(topic, qos, retain, payload, strlen(payload)) == 0)
+      {
+        DEBUG(F("MQTT: Publishing failed."));
+        publishFailures++;
+      }
     }
   }
 
@@ -190,7 +299,7 @@ private:
       char message[64];
       snprintf(message, 64, "Hello from %08X, running SMLReader version %s.", ESP.getChipId(), VERSION);
       info(message);
-      publish(baseTopic + MQTT_LWT_TOPIC, MQTT_LWT_PAYLOAD_ONLINE, MQTT_LWT_QOS, MQTT_LWT_RETAIN);
+      publish(lastWillTopic, MQTT_LWT_PAYLOAD_ONLINE, MQTT_LWT_QOS, MQTT_LWT_RETAIN);
     });
     client.onDisconnect([this](AsyncMqttClientDisconnectReason reason) {
       this->connected = false;
@@ -2,7 +2,8 @@
 #define SENSOR_H
 
 #include <SoftwareSerial.h>
-#include <jled.h>
+#include "StatusLed.h"
+#include <sml/sml_crc16.h>
 #include "debug.h"
 
 using namespace std;
@@ -12,6 +13,15 @@ const byte START_SEQUENCE[] = {0x1B, 0x1B, 0x1B, 0x1B, 0x01, 0x01, 0x01, 0x01};
 const byte END_SEQUENCE[] = {0x1B, 0x1B, 0x1B, 0x1B, 0x1A};
 const size_t BUFFER_SIZE = 3840; // Max datagram duration 400ms at 9600 Baud
 const uint8_t READ_TIMEOUT = 30;
+// Max duration in seconds for holding back a message that could not be delivered, before a fresh one is read.
+// Until the first message has been delivered, READ_TIMEOUT applies instead, so that the message received while booting survives connecting.
+const uint8_t HOLD_TIMEOUT = 5;
+// Size of the serial receive buffer in bytes, it has to hold all bytes arriving during an iteration of the main loop including the processing of a message (~1ms per byte at 9600 Baud).
+// The default holds a full message period of a meter sending 4 messages per second. If the heartbeat reports a serial_peak close to it,
+// increase it by adding -DSERIAL_BUFFER_SIZE=<bytes> to the build flags.
+#ifndef SERIAL_BUFFER_SIZE
+#define SERIAL_BUFFER_SIZE 256
+#endif
 
 // States
 enum State
@@ -21,7 +31,8 @@ enum State
     WAIT_FOR_START_SEQUENCE,
     READ_MESSAGE,
     PROCESS_MESSAGE,
-    READ_CHECKSUM
+    READ_CHECKSUM,
+    HOLD
 };
 
 uint64_t millis64()
@@ -34,6 +45,22 @@ uint64_t millis64()
     return (uint64_t)high32 << 32 | low32;
 }
 
+// Transports for streaming decoded messages to local consumers
+enum StreamTransport
+{
+    STREAM_NONE,
+    STREAM_UDP,
+    STREAM_TCP
+};
+
+// Encodings for publishing raw messages instead of decoded values
+enum RawMode
+{
+    RAW_NONE,
+    RAW_PLAIN,
+    RAW_PACKBITS
+};
+
 class SensorConfig
 {
 public:
@@ -44,30 +71,45 @@ public:
     const bool status_led_inverted;
     const uint8_t status_led_pin;
     const uint8_t interval;
+    const StreamTransport stream;
+    const RawMode raw;
+};
+
+// Counters describing the health of a reading head
+struct SensorMetrics
+{
+    // Number of start sequences found, including messages dropped later on
+    uint32_t started = 0;
+    uint32_t frames = 0;
+    uint32_t crc_errors = 0;
+    uint32_t malformed = 0;
+    uint32_t overflows = 0;
+    uint32_t timeouts = 0;
+    uint32_t serial_overflows = 0;
+    // Largest number of bytes waiting in the serial receive buffer at the beginning of a loop
+    uint32_t serial_peak = 0;
+    unsigned long process_max = 0;
+    unsigned long last_frame = 0;
 };
 
 class Sensor
 {
 public:
     const SensorConfig *config;
-    Sensor(const SensorConfig *config, void (*callback)(byte *buffer, size_t len, Sensor *sensor))
+    Sensor(const SensorConfig *config, bool (*callback)(byte *buffer, size_t len, Sensor *sensor), StatusLedDriver *status_leds)
     {
         this->config = config;
         DEBUG("Initializing sensor %s...", this->config->name);
         this->callback = callback;
         this->serial = unique_ptr<SoftwareSerial>(new SoftwareSerial());
-        this->serial->begin(9600, SWSERIAL_8N1, this->config->pin, -1, false);
+        this->serial->begin(9600, SWSERIAL_8N1, this->config->pin, -1, false, SERIAL_BUFFER_SIZE);
         this->serial->enableTx(false);
         this->serial->enableRx(true);
         DEBUG("Initialized sensor %s.", this->config->name);
 
         if (this->config->status_led_enabled)
         {
-            this->status_led = unique_ptr<JLed>(new JLed(this->config->status_led_pin));
-            if (this->config->status_led_inverted)
-            {
-                this->status_led->LowActive();
-            }
+            this->status_led = status_leds->get(this->config->status_led_pin, this->config->status_led_inverted);
         }
 
         this->init_state();
@@ -75,56 +117,81 @@ public:
 
     void loop()
     {
+        uint32_t available = this->data_available();
+        if (available > this->metrics.serial_peak)
+        {
+            this->metrics.serial_peak = available;
+        }
         this->run_current_state();
         yield();
-        if (this->config->status_led_enabled)
+        if (this->serial->overflow())
         {
-            this->status_led->Update();
-            yield();
+            this->metrics.serial_overflows++;
         }
     }
 
+    const SensorMetrics &get_metrics() const
+    {
+        return this->metrics;
+    }
+
 private:
     unique_ptr<SoftwareSerial> serial;
     byte buffer[BUFFER_SIZE];
     size_t position = 0;
+    // Position of the last start sequence found within the message, 0 if there is none
+    size_t restart = 0;
     unsigned long last_state_reset = 0;
     uint64_t standby_until = 0;
     uint8_t bytes_until_checksum = 0;
     uint8_t loop_counter = 0;
     State state = INIT;
-    void (*callback)(byte *buffer, size_t len, Sensor *sensor) = NULL;
-    unique_ptr<JLed> status_led;
+    unsigned long hold_since = 0;
+    bool delivered = false;
+    bool (*callback)(byte *buffer, size_t len, Sensor *sensor) = NULL;
+    StatusLed *status_led = NULL;
+    SensorMetrics metrics;
 
     void run_current_state()
     {
         if (this->state != INIT)
         {
-            if (this->state != STANDBY && ((millis() - this->last_state_reset) > (READ_TIMEOUT * 1000)))
+            if (this->state != STANDBY && this->state != HOLD && ((millis() - this->last_state_reset) > (READ_TIMEOUT * 1000)))
             {
                 DEBUG("Did not receive an SML message within %d seconds, starting over.", READ_TIMEOUT);
+                this->metrics.timeouts++;
                 this->reset_state();
             }
-            switch (this->state)
+            // Keep going while bytes are available, so that a message is read and processed within a single iteration of the main loop
+            State previous;
+            do
             {
-            case STANDBY:
-                this->standby();
-                break;
-            case WAIT_FOR_START_SEQUENCE:
-                this->wait_for_start_sequence();
-                break;
-            case READ_MESSAGE:
-                this->read_message();
-                break;
-            case PROCESS_MESSAGE:
-                this->process_message();
-                break;
-            case READ_CHECKSUM:
-                this->read_checksum();
-                break;
-            default:
-                break;
-            }
+                previous = this->state;
+                switch (this->state)
+                {
+                case STANDBY:
+                    this->standby();
+                    break;
+                case WAIT_FOR_START_SEQUENCE:
+                    this->wait_for_start_sequence();
+                    break;
+                case READ_MESSAGE:
+                    this->read_message();
+                    break;
+                case PROCESS_MESSAGE:
+                    this->process_message();
+                    break;
+                case READ_CHECKSUM:
+                    this->read_checksum();
+                    break;
+                case HOLD:
+                    this->hold();
+                    break;
+                default:
+                    break;
+                }
+            } while (this->state != previous && this->state != STANDBY && this->state != HOLD &&
+                     (this->state == PROCESS_MESSAGE || this->data_available()));
         }
     }
 
@@ -138,9 +205,21 @@ private:
         return this->serial->read();
     }
 
+    void signal_error()
+    {
+        if (this->status_led != NULL)
+        {
+            this->status_led->frame_error();
+        }
+    }
+
     // Set state
     void set_state(State new_state)
     {
+        if (this->status_led != NULL && (this->state == HOLD) != (new_state == HOLD))
+        {
+            this->status_led->set_holding(new_state == HOLD);
+        }
         if (new_state == STANDBY)
         {
             DEBUG("State of sensor %s is 'STANDBY'.", this->config->name);
@@ -150,6 +229,7 @@ private:
             DEBUG("State of sensor %s is 'WAIT_FOR_START_SEQUENCE'.", this->config->name);
             this->last_state_reset = millis();
             this->position = 0;
+            this->restart = 0;
         }
         else if (new_state == READ_MESSAGE)
         {
@@ -163,6 +243,11 @@ private:
         else if (new_state == PROCESS_MESSAGE)
         {
             DEBUG("State of sensor %s is 'PROCESS_MESSAGE'.", this->config->name);
+        }
+        else if (new_state == HOLD)
+        {
+            DEBUG("State of sensor %s is 'HOLD'.", this->config->name);
+            this->hold_since = millis();
         };
         this->state = new_state;
     }
@@ -203,18 +288,28 @@ private:
     {
         while (this->data_available())
         {
-            this->buffer[this->position] = this->data_read();
+            byte data = this->data_read();
             yield();
 
-            this->position = (this->buffer[this->position] == START_SEQUENCE[this->position]) ? (this->position + 1) : 0;
+            if (data == START_SEQUENCE[this->position])
+            {
+                this->buffer[this->position++] = data;
+            }
+            else if (data == START_SEQUENCE[0])
+            {
+                // Resynchronize without dropping the escape bytes that have already been matched
+                this->position = (this->position == 4) ? 4 : 1;
+                this->buffer[0] = data;
+            }
+            else
+            {
+                this->position = 0;
+            }
             if (this->position == sizeof(START_SEQUENCE))
             {
                 // Start sequence has been found
                 DEBUG("Start sequence found.");
-                if (this->config->status_led_enabled)
-                {
-                    this->status_led->Blink(50, 50).Repeat(3);
-                }
+                this->metrics.started++;
                 this->set_state(READ_MESSAGE);
                 return;
             }
@@ -229,30 +324,65 @@ private:
             // Check whether the buffer is still big enough to hold the number of fill bytes (1 byte) and the checksum (2 bytes)
             if ((this->position + 3) == BUFFER_SIZE)
             {
-                this->reset_state("Buffer will overflow, starting over.");
-                return;
+                if (this->restart == 0)
+                {
+                    this->metrics.overflows++;
+                    this->reset_state("Buffer will overflow, starting over.");
+                    return;
+                }
+                this->resync();
             }
             this->buffer[this->position++] = this->data_read();
             yield();
 
-            // Check for end sequence
-            int last_index_of_end_seq = sizeof(END_SEQUENCE) - 1;
-            for (int i = 0; i <= last_index_of_end_seq; i++)
+            // A start sequence within the message means that it has been truncated, unless it is part of the payload.
+            // Remember it, so that the message following a truncated one is not lost as well.
+            if (this->position > sizeof(START_SEQUENCE) && this->ends_with(START_SEQUENCE, sizeof(START_SEQUENCE)))
             {
-                if (END_SEQUENCE[last_index_of_end_seq - i] != this->buffer[this->position - (i + 1)])
-                {
-                    break;
-                }
-                if (i == last_index_of_end_seq)
-                {
-                    DEBUG("End sequence found.");
-                    this->set_state(READ_CHECKSUM);
-                    return;
-                }
+                this->restart = this->position - sizeof(START_SEQUENCE);
+                continue;
+            }
+
+            // Check for end sequence, which is always aligned to 4 bytes
+            if (this->position < sizeof(START_SEQUENCE) + sizeof(END_SEQUENCE) || !this->ends_with(END_SEQUENCE, sizeof(END_SEQUENCE)))
+            {
+                continue;
+            }
+            size_t end = this->position - sizeof(END_SEQUENCE);
+            if ((end % 4) == 0)
+            {
+                DEBUG("End sequence found.");
+                this->set_state(READ_CHECKSUM);
+                return;
+            }
+            if (this->restart > 0 && end >= this->restart + sizeof(START_SEQUENCE) && ((end - this->restart) % 4) == 0)
+            {
+                DEBUG("End sequence of a message following a truncated one found.");
+                this->resync();
+                this->set_state(READ_CHECKSUM);
+                return;
             }
         }
     }
 
+    bool ends_with(const byte *sequence, size_t len)
+    {
+        return memcmp(this->buffer + this->position - len, sequence, len) == 0;
+    }
+
+    // Drop the truncated message in front of the last start sequence found
+    void resync()
+    {
+        DEBUG("Message has been truncated, continuing with the next one.");
+        this->metrics.malformed++;
+        this->metrics.started++;
+        this->signal_error();
+        memmove(this->buffer, this->buffer + this->restart, this->position - this->restart);
+        this->position -= this->restart;
+        this->restart = 0;
+        this->last_state_reset = millis();
+    }
+
     // Read the number of fillbytes and the checksum
     void read_checksum()
     {
@@ -267,10 +397,44 @@ private:
         {
             DEBUG("Message has been read.");
             DEBUG_DUMP_BUFFER(this->buffer, this->position);
+            // A truncated message followed by a complete one, whose end sequence is aligned for both of them
+            if (this->restart > 0 && (this->restart % 4) == 0 && !this->verify_checksum())
+            {
+                this->resync();
+            }
+            // The message is padded to a multiple of 4 bytes, so there are at most 3 fill bytes
+            if (this->buffer[this->position - 3] > 3)
+            {
+                this->metrics.malformed++;
+                this->signal_error();
+                this->reset_state("Invalid number of fill bytes, starting over.");
+                return;
+            }
+            if (!this->verify_checksum())
+            {
+                this->metrics.crc_errors++;
+                this->signal_error();
+                this->reset_state("Checksum mismatch, starting over.");
+                return;
+            }
+            this->metrics.frames++;
+            this->metrics.last_frame = millis();
+            if (this->status_led != NULL)
+            {
+                this->status_led->frame_ok();
+            }
             this->set_state(PROCESS_MESSAGE);
         }
     }
 
+    // Compare the CRC16 (X.25) of the message with the checksum sent by the meter
+    bool verify_checksum()
+    {
+        uint16_t crc = sml_crc16_calculate(this->buffer, this->position - 2);
+        return this->buffer[this->position - 2] == ((crc & 0xFF00) >> 8) &&
+               this->buffer[this->position - 1] == (crc & 0x00FF);
+    }
+
     void process_message()
     {
         DEBUG("Message is being processed.");
@@ -280,12 +444,59 @@ private:
             this->standby_until = millis64() + (this->config->interval * 1000);
         }
 
-        // Call listener
-        if (this->callback != NULL)
+        // Call listener, it may refuse the message as long as it is not able to deliver it (i.e. while booting)
+        if (this->callback != NULL && !this->call_listener())
+        {
+            DEBUG("Message could not be delivered, holding it back.");
+            this->set_state(HOLD);
+            return;
+        }
+
+        this->finish_message();
+    }
+
+    // Keep the last message until the listener accepts it
+    void hold()
+    {
+        // Keep buffers clean
+        while (this->data_available())
         {
-            this->callback(this->buffer, this->position, this);
+            this->data_read();
+            yield();
         }
 
+        if (this->call_listener())
+        {
+            DEBUG("Message has been delivered.");
+            this->finish_message();
+            return;
+        }
+
+        uint8_t timeout = this->delivered ? HOLD_TIMEOUT : READ_TIMEOUT;
+        if ((millis() - this->hold_since) > (timeout * 1000UL))
+        {
+            // Rather deliver a fresh message later on
+            this->reset_state("Message could not be delivered in time, dropping it.");
+        }
+    }
+
+    // Call the listener and keep track of the processing time, the serial receive buffer has to bridge it
+    bool call_listener()
+    {
+        unsigned long start = millis();
+        bool delivered = this->callback(this->buffer, this->position, this);
+        unsigned long duration = millis() - start;
+        if (duration > this->metrics.process_max)
+        {
+            this->metrics.process_max = duration;
+        }
+        return delivered;
+    }
+
+    void finish_message()
+    {
+        this->delivered = true;
+
         // Go to standby mode, if throttling is enabled
         if (this->config->interval > 0)
         {
@@ -0,0 +1,243 @@
+#ifndef SNAPSHOT_COORDINATOR_H
+#define SNAPSHOT_COORDINATOR_H
+
+#include "config.h"
+#include "debug.h"
+#include "format.h"
+#include <sml/sml_file.h>
+
+#define SNAPSHOT_MAX_VALUES 16
+// Values are printed with at most 6 decimals and 15 digits before the decimal point, larger ones with 15 significant digits
+#define SNAPSHOT_MAX_PRECISION 6
+#define SNAPSHOT_MAX_NUMBER_LENGTH 23
+// ,"255-255:255.255.255/255":<number>
+#define SNAPSHOT_MAX_ENTRY_LENGTH (27 + SNAPSHOT_MAX_NUMBER_LENGTH)
+// Sensor names exceeding this length may cause records of all values to be dropped
+#define SNAPSHOT_MAX_NAME_LENGTH 16
+// ,"<name>":{"age":<ms>,"values":{...}}
+#define SNAPSHOT_MAX_SENSOR_LENGTH (34 + SNAPSHOT_MAX_NAME_LENGTH + SNAPSHOT_MAX_VALUES * SNAPSHOT_MAX_ENTRY_LENGTH)
+// {"time":<ms>...} and the terminating null byte
+#define SNAPSHOT_MAX_PAYLOAD_LENGTH (20 + NUM_OF_SENSORS * SNAPSHOT_MAX_SENSOR_LENGTH)
+
+using namespace std;
+
+struct SnapshotValue
+{
+  unsigned char obis[6];
+  int prec;
+  double value;
+  unsigned long time;
+  double previous_value;
+  unsigned long previous_time;
+};
+
+struct SensorSnapshot
+{
+  Sensor *sensor = NULL;
+  unsigned long time = 0;
+  uint8_t count = 0;
+  SnapshotValue values[SNAPSHOT_MAX_VALUES];
+};
+
+// Collects the latest numeric values of all sensors and combines them into a single record,
+// so that values of different meters can be related to each other.
+// If interpolation is enabled, the values are interpolated to the time of the oldest of the
+// latest messages of all sensors, which is the latest point in time covered by every sensor.
+// Sensors that went silent are left out, so that they neither hold back this point in time
+// nor contribute outdated values.
+class SnapshotCoordinator
+{
+public:
+  void update(Sensor *sensor, sml_file *file)
+  {
+    SensorSnapshot *snapshot = this->get(sensor);
+    if (snapshot == NULL)
+    {
+      return;
+    }
+    // Relate the values to the reception of the message, which may have been held back before being delivered
+    unsigned long time = sensor->get_metrics().last_frame;
+    snapshot->time = time;
+
+    for (int i = 0; i < file->messages_len; i++)
+    {
+      sml_message *message = file->messages[i];
+      if (is_get_list_response(message))
+      {
+        sml_list *entry;
+        sml_get_list_response *body;
+        body = (sml_get_list_response *)message->message_body->data;
+        for (entry = body->val_list; entry != NULL; entry = entry->next)
+        {
+          if (!entry->value || !entry->obj_name || entry->obj_name->len < 6 ||
+              !(((entry->value->type & SML_TYPE_FIELD) == SML_TYPE_INTEGER) ||
+                ((entry->value->type & SML_TYPE_FIELD) == SML_TYPE_UNSIGNED)))
+          {
+            continue;
+          }
+          SnapshotValue *value = this->get(snapshot, entry->obj_name->str, time);
+          if (value == NULL)
+          {
+            continue;
+          }
+          int scaler = (entry->scaler) ? *entry->scaler : 0;
+          value->prec = (scaler < 0) ? min(-scaler, SNAPSHOT_MAX_PRECISION) : 0;
+          value->previous_value = value->value;
+          value->previous_time = value->time;
+          value->value = sml_value_to_double(entry->value) * pow(10, scaler);
+          value->time = time;
+        }
+      }
+    }
+  }
+
+  // Returns the combined record if the next one is due, NULL otherwise
+  const char *poll(unsigned long interval, bool interpolate, unsigned long max_age)
+  {
+    unsigned long now = millis();
+    if (interval == 0 || (now - this->last_snapshot) < interval)
+    {
+      return NULL;
+    }
+    this->last_snapshot = now;
+
+    // Determine the point in time all values are related to
+    unsigned long time = now;
+    bool empty = true;
+    for (uint8_t i = 0; i < NUM_OF_SENSORS; i++)
+    {
+      if (this->is_current(&this->snapshots[i], now, max_age))
+      {
+        if (interpolate && (empty || (long)(this->snapshots[i].time - time) < 0))
+        {
+          time = this->snapshots[i].time;
+        }
+        empty = false;
+      }
+    }
+    if (empty)
+    {
+      return NULL;
+    }
+
+    size_t pos = snprintf(this->payload, sizeof(this->payload), "{\"time\":%lu", time);
+    for (uint8_t i = 0; i < NUM_OF_SENSORS && pos < sizeof(this->payload); i++)
+    {
+      SensorSnapshot *snapshot = &this->snapshots[i];
+      if (!this->is_current(snapshot, now, max_age))
+      {
+        continue;
+      }
+      pos += snprintf(this->payload + pos, sizeof(this->payload) - pos, ",\"%s\":{\"age\":%lu,\"values\":{",
+                      snapshot->sensor->config->name, now - snapshot->time);
+      for (uint8_t j = 0; j < snapshot->count && pos < sizeof(this->payload); j++)
+      {
+        SnapshotValue *value = &snapshot->values[j];
+        pos += snprintf(this->payload + pos, sizeof(this->payload) - pos, "%s\"%d-%d:%d.%d.%d/%d\":",
+                        j > 0 ? "," : "",
+                        value->obis[0], value->obis[1], value->obis[2],
+                        value->obis[3], value->obis[4], value->obis[5]);
+        if (pos < sizeof(this->payload))
+        {
+          pos += format_number(this->payload + pos, sizeof(this->payload) - pos,
+                               interpolate ? this->interpolate(value, time) : value->value, value->prec);
+        }
+      }
+      if (pos < sizeof(this->payload))
+      {
+        pos += snprintf(this->payload + pos, sizeof(this->payload) - pos, "}}");
+      }
+    }
+    if (pos < sizeof(this->payload))
+    {
+      pos += snprintf(this->payload + pos, sizeof(this->payload) - pos, "}");
+    }
+    if (pos >= sizeof(this->payload))
+    {
+      DEBUG(F("Snapshot: Payload size exceeded, skipping snapshot."));
+      this->drops++;
+      return NULL;
+    }
+    return this->payload;
+  }
+
+  // Number of records that have been dropped because they exceeded the payload size
+  uint32_t get_drops() const
+  {
+    return this->drops;
+  }
+
+private:
+  SensorSnapshot snapshots[NUM_OF_SENSORS];
+  unsigned long last_snapshot = 0;
+  uint32_t drops = 0;
+  char payload[SNAPSHOT_MAX_PAYLOAD_LENGTH];
+
+  SensorSnapshot *get(Sensor *sensor)
+  {
+    for (uint8_t i = 0; i < NUM_OF_SENSORS; i++)
+    {
+      if (this->snapshots[i].sensor == sensor || this->snapshots[i].sensor == NULL)
+      {
+        this->snapshots[i].sensor = sensor;
+        return &this->snapshots[i];
+      }
+    }
+    return NULL;
+  }
+
+  // Whether the sensor has values and its latest message is not older than max_age (0 = no limit)
+  bool is_current(SensorSnapshot *snapshot, unsigned long now, unsigned long max_age)
+  {
+    return snapshot->count > 0 && (max_age == 0 || (now - snapshot->time) <= max_age);
+  }
+
+  SnapshotValue *get(SensorSnapshot *snapshot, const unsigned char *obis, unsigned long time)
+  {
+    for (uint8_t i = 0; i < snapshot->count; i++)
+    {
+      if (memcmp(snapshot->values[i].obis, obis, 6) == 0)
+      {
+        return &snapshot->values[i];
+      }
+    }
+    if (snapshot->count == SNAPSHOT_MAX_VALUES)
+    {
+      return NULL;
+    }
+    // First occurrence, there is no previous value to interpolate from
+    SnapshotValue *value = &snapshot->values[snapshot->count++];
+    memcpy(value->obis, obis, 6);
+    value->value = 0;
+    value->time = time;
+    return value;
+  }
+
+  // Prints a value with at most SNAPSHOT_MAX_NUMBER_LENGTH characters
+  static size_t format_number(char *buffer, size_t size, double value, int prec)
+  {
+    if (fabs(value) < 1e14)
+    {
+      return snprintf(buffer, size, "%.*f", prec, value);
+    }
+    return snprintf(buffer, size, "%.15g", value);
+  }
+
+  // Linear interpolation between the previous and the latest value, values outside of that span are clamped
+  double interpolate(SnapshotValue *value, unsigned long time)
+  {
+    long span = value->time - value->previous_time;
+    long offset = time - value->previous_time;
+    if (span <= 0 || offset >= span)
+    {
+      return value->value;
+    }
+    if (offset <= 0)
+    {
+      return value->previous_value;
+    }
+    return value->previous_value + (value->value - value->previous_value) * offset / span;
+  }
+};
+
+#endif
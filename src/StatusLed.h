@@ -0,0 +1,129 @@
+#ifndef STATUS_LED_H
+#define STATUS_LED_H
+
+#include <list>
+#include <jled.h>
+#include <Ticker.h>
+
+#define STATUS_LED_UPDATE_INTERVAL 10
+// Duration in milliseconds an error is signaled for, without being overridden by received messages
+#define STATUS_LED_ERROR_LATCH 3000
+
+using namespace std;
+
+// Status LED, shared by all sensors using the same pin
+//
+// Patterns:
+// - 1 short flash: message received
+// - 1 long flash: message dropped (checksum error or malformed), takes precedence over received messages for 3 seconds
+// - 1 short flash every 2 seconds: MQTT offline
+// - 2 short flashes every 2 seconds: MQTT offline, holding back a message
+class StatusLed
+{
+public:
+    const uint8_t pin;
+
+    StatusLed(uint8_t pin, bool inverted) : pin(pin), led(pin)
+    {
+        if (inverted)
+        {
+            this->led.LowActive();
+        }
+    }
+
+    void frame_ok()
+    {
+        // Do not cut off the signaling of a recent error
+        if ((long)(millis() - this->error_until) < 0)
+        {
+            return;
+        }
+        this->led.Blink(50, 50).Repeat(1);
+    }
+
+    void frame_error()
+    {
+        this->error_until = millis() + STATUS_LED_ERROR_LATCH;
+        this->led.Blink(1000, 100).Repeat(1);
+    }
+
+    void set_holding(bool holding)
+    {
+        if (holding)
+        {
+            this->holding++;
+        }
+        else if (this->holding > 0)
+        {
+            this->holding--;
+        }
+    }
+
+    void update(bool offline)
+    {
+        if (this->led.Update())
+        {
+            return;
+        }
+        // Nothing to signal, fall back to the connection state
+        if (offline && this->holding > 0)
+        {
+            this->led.Blink(100, 100).Repeat(2).DelayAfter(1600);
+        }
+        else if (offline)
+        {
+            this->led.Blink(100, 1900).Repeat(1);
+        }
+    }
+
+private:
+    JLed led;
+    uint8_t holding = 0;
+    unsigned long error_until = 0;
+};
+
+// Updates all status LEDs from a single timer instead of the main loop
+class StatusLedDriver
+{
+public:
+    StatusLed *get(uint8_t pin, bool inverted)
+    {
+        for (list<StatusLed *>::iterator it = this->leds.begin(); it != this->leds.end(); ++it)
+        {
+            if ((*it)->pin == pin)
+            {
+                return *it;
+            }
+        }
+        StatusLed *led = new StatusLed(pin, inverted);
+        this->leds.push_back(led);
+        return led;
+    }
+
+    void begin()
+    {
+        this->ticker.attach_ms(STATUS_LED_UPDATE_INTERVAL, [this]() {
+            this->update();
+        });
+    }
+
+    void set_offline(bool offline)
+    {
+        this->offline = offline;
+    }
+
+private:
+    list<StatusLed *> leds;
+    Ticker ticker;
+    bool offline = false;
+
+    void update()
+    {
+        for (list<StatusLed *>::iterator it = this->leds.begin(); it != this->leds.end(); ++it)
+        {
+            (*it)->update(this->offline);
+        }
+    }
+};
+
+#endif
@@ -0,0 +1,221 @@
+#ifndef STREAM_PUBLISHER_H
+#define STREAM_PUBLISHER_H
+
+#include "config.h"
+#include "debug.h"
+#include "format.h"
+
+#include <ESP8266WiFi.h>
+#include <WiFiUdp.h>
+#include <ESPAsyncTCP.h>
+#include <sml/sml_file.h>
+
+#define STREAM_UDP_MULTICAST_ADDRESS IPAddress(239, 12, 34, 56)
+#define STREAM_UDP_PORT 5432
+#define STREAM_TCP_PORT 5432
+#define STREAM_TCP_MAX_CLIENTS 4
+#define STREAM_MAX_PACKET_SIZE 1024
+#define STREAM_MAX_PING_SIZE 64
+
+using namespace std;
+
+// Pushes every decoded message to local consumers, bypassing the MQTT broker.
+// Each message is sent as one UDP datagram or TCP chunk consisting of lines of
+// the form "<sensor>;<millis>;<obis>;<value>;<unit>;<name>\n".
+// For measuring the latency, consumers may send "ping;<token>\n" via TCP or as unicast
+// datagram to the UDP port and get "pong;<token>;<millis>\n" in return, which relates
+// the uptime in the messages to their own clock.
+class StreamPublisher
+{
+public:
+  void setup()
+  {
+    if (this->started)
+    {
+      return;
+    }
+    if (isUsed(STREAM_TCP))
+    {
+      DEBUG(F("Stream: Starting TCP server on port %d..."), STREAM_TCP_PORT);
+      server.onClient([this](void *arg, AsyncClient *client) {
+        this->addClient(client);
+      }, NULL);
+      server.setNoDelay(true);
+      server.begin();
+    }
+    if (isUsed(STREAM_UDP))
+    {
+      DEBUG(F("Stream: Listening for pings on UDP port %d..."), STREAM_UDP_PORT);
+      udp.begin(STREAM_UDP_PORT);
+      this->udpStarted = true;
+    }
+    this->started = true;
+  }
+
+  // Answers pings received via UDP
+  void loop()
+  {
+    if (!this->udpStarted || udp.parsePacket() <= 0)
+    {
+      return;
+    }
+    char request[STREAM_MAX_PING_SIZE];
+    int len = udp.read(request, sizeof(request) - 1);
+    char response[STREAM_MAX_PING_SIZE + 16];
+    size_t responseLen = pong(request, len > 0 ? len : 0, response, sizeof(response));
+    if (responseLen > 0)
+    {
+      udp.beginPacket(udp.remoteIP(), udp.remotePort());
+      udp.write((const uint8_t *)response, responseLen);
+      udp.endPacket();
+    }
+  }
+
+  void publish(Sensor *sensor, sml_file *file)
+  {
+    if (sensor->config->stream == STREAM_NONE || !WiFi.isConnected())
+    {
+      return;
+    }
+
+    size_t len = this->format(sensor, file);
+    if (len == 0)
+    {
+      return;
+    }
+
+    if (sensor->config->stream == STREAM_UDP)
+    {
+      udp.beginPacketMulticast(STREAM_UDP_MULTICAST_ADDRESS, STREAM_UDP_PORT, WiFi.localIP());
+      udp.write((const uint8_t *)this->packet, len);
+      udp.endPacket();
+    }
+    else if (sensor->config->stream == STREAM_TCP)
+    {
+      for (uint8_t i = 0; i < STREAM_TCP_MAX_CLIENTS; i++)
+      {
+        AsyncClient *client = this->clients[i];
+        // Slow consumers are skipped rather than delaying the others
+        if (client != NULL && client->canSend() && client->space() >= len)
+        {
+          client->add(this->packet, len);
+          client->send();
+        }
+      }
+    }
+  }
+
+  // Whether any sensor streams its messages via the given transport
+  static bool isUsed(StreamTransport transport)
+  {
+    for (uint8_t i = 0; i < NUM_OF_SENSORS; i++)
+    {
+      if (SENSOR_CONFIGS[i].stream == transport)
+      {
+        return true;
+      }
+    }
+    return false;
+  }
+
+private:
+  bool started = false;
+  bool udpStarted = false;
+  WiFiUDP udp;
+  AsyncServer server{STREAM_TCP_PORT};
+  AsyncClient *clients[STREAM_TCP_MAX_CLIENTS] = {};
+  char packet[STREAM_MAX_PACKET_SIZE];
+
+  size_t format(Sensor *sensor, sml_file *file)
+  {
+    size_t pos = 0;
+    unsigned long now = millis();
+    for (int i = 0; i < file->messages_len; i++)
+    {
+      sml_message *message = file->messages[i];
+      if (is_get_list_response(message))
+      {
+        sml_list *entry;
+        sml_get_list_response *body;
+        body = (sml_get_list_response *)message->message_body->data;
+        for (entry = body->val_list; entry != NULL; entry = entry->next)
+        {
+          char obisIdentifier[32];
+          char value[128];
+          char unit[DLMS_UNIT_MAX_LENGTH];
+          char name[OBIS_NAME_MAX_LENGTH];
+
+          if (!format_obis(entry, obisIdentifier, sizeof(obisIdentifier)) ||
+              !format_value(entry, sensor->config->numeric_only, value, sizeof(value)))
+          {
+            continue;
+          }
+          format_unit(entry, unit, sizeof(unit));
+          format_name(entry, name, sizeof(name));
+
+          int written = snprintf(this->packet + pos, sizeof(this->packet) - pos, "%s;%lu;%s;%s;%s;%s\n",
+                                 sensor->config->name, now, obisIdentifier, value, unit, name);
+          if (written < 0 || (pos + written) >= sizeof(this->packet))
+          {
+            // Drop the truncated line, the packet is full
+            DEBUG(F("Stream: Packet size exceeded, skipping remaining values."));
+            return pos;
+          }
+          pos += written;
+        }
+      }
+    }
+    return pos;
+  }
+
+  // Builds the answer to "ping;<token>\n", returns 0 if the request is not a ping
+  static size_t pong(const char *request, size_t len, char *response, size_t size)
+  {
+    if (len < 5 || len >= STREAM_MAX_PING_SIZE || strncmp(request, "ping;", 5) != 0)
+    {
+      return 0;
+    }
+    size_t tokenLen = len - 5;
+    while (tokenLen > 0 && (request[5 + tokenLen - 1] == '\n' || request[5 + tokenLen - 1] == '\r'))
+    {
+      tokenLen--;
+    }
+    int written = snprintf(response, size, "pong;%.*s;%lu\n", (int)tokenLen, request + 5, millis());
+    return (written > 0 && (size_t)written < size) ? written : 0;
+  }
+
+  void addClient(AsyncClient *client)
+  {
+    for (uint8_t i = 0; i < STREAM_TCP_MAX_CLIENTS; i++)
+    {
+      if (this->clients[i] == NULL)
+      {
+        DEBUG(F("Stream: Client %s connected."), client->remoteIP().toString().c_str());
+        this->clients[i] = client;
+        client->setNoDelay(true);
+        client->onData([](void *arg, AsyncClient *client, void *data, size_t len) {
+          char response[STREAM_MAX_PING_SIZE + 16];
+          size_t responseLen = pong((const char *)data, len, response, sizeof(response));
+          if (responseLen > 0 && client->space() >= responseLen)
+          {
+            client->add(response, responseLen);
+            client->send();
+          }
+        }, NULL);
+        client->onDisconnect([this, i](void *arg, AsyncClient *client) {
+          DEBUG(F("Stream: Client disconnected."));
+          this->clients[i] = NULL;
+          delete client;
+        }, NULL);
+        return;
+      }
+    }
+    DEBUG(F("Stream: Too many clients, rejecting connection."));
+    client->onDisconnect([](void *arg, AsyncClient *client) {
+      delete client;
+    }, NULL);
+    client->close(true);
+  }
+};
+
+#endif
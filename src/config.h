@@ -20,8 +20,18 @@ static const SensorConfig SENSOR_CONFIGS[] = {
      .status_led_enabled = true,
      .status_led_inverted = true,
      .status_led_pin = LED_BUILTIN,
-     .interval = 0}};
+     .interval = 0,
+     .stream = STREAM_NONE,
+     .raw = RAW_NONE}};
 
 const uint8_t NUM_OF_SENSORS = sizeof(SENSOR_CONFIGS) / sizeof(SensorConfig);
 
+// If greater than 0, the latest values of all sensors are published as one combined record every [SNAPSHOT_INTERVAL] milliseconds
+const unsigned long SNAPSHOT_INTERVAL = 0;
+// Interpolate the values of all sensors to a common point in time
+const bool SNAPSHOT_INTERPOLATE = false;
+// Sensors whose latest message is older than [SNAPSHOT_MAX_AGE] milliseconds are left out of the record (0 = no limit),
+// this has to be greater than the sending interval of the slowest meter
+const unsigned long SNAPSHOT_MAX_AGE = 2 * SNAPSHOT_INTERVAL;
+
 #endif
\ No newline at end of file
@@ -4,7 +4,7 @@
 #include "FormattingSerialDebug.h"
 #include <sml/sml_file.h>
 #include <sml/sml_value.h>
-#include "unit.h"
+#include "format.h"
 
 #ifdef DEBUG
 #define SERIAL_DEBUG true
@@ -45,7 +45,7 @@ void DEBUG_SML_FILE(sml_file *file)
     for (int i = 0; i < file->messages_len; i++)
     {
         sml_message *message = file->messages[i];
-        if (*message->message_body->tag == SML_MESSAGE_GET_LIST_RESPONSE)
+        if (is_get_list_response(message))
         {
             sml_list *entry;
             sml_get_list_response *body;
@@ -57,6 +57,11 @@ void DEBUG_SML_FILE(sml_file *file)
                     fprintf(stderr, "Error in data stream. entry->value should not be NULL. Skipping this.\n");
                     continue;
                 }
+                if (!entry->obj_name || entry->obj_name->len < 6)
+                {
+                    fprintf(stderr, "Error in data stream. entry->obj_name is incomplete. Skipping this.\n");
+                    continue;
+                }
                 if (entry->value->type == SML_TYPE_OCTET_STRING)
                 {
                     char *str;
@@ -88,10 +93,13 @@ void DEBUG_SML_FILE(sml_file *file)
                            entry->obj_name->str[0], entry->obj_name->str[1],
                            entry->obj_name->str[2], entry->obj_name->str[3],
                            entry->obj_name->str[4], entry->obj_name->str[5], prec, value);
-                    const char *unit = NULL;
+                    char unit[DLMS_UNIT_MAX_LENGTH];
                     if (entry->unit && // do not crash on null (unit is optional)
-                        (unit = dlms_get_unit((unsigned char)*entry->unit)) != NULL)
+                        dlms_get_unit((unsigned char)*entry->unit, unit, sizeof(unit)))
                         printf("%s", unit);
+                    char name[OBIS_NAME_MAX_LENGTH];
+                    if (obis_get_name(entry->obj_name->str, name, sizeof(name)))
+                        printf(" (%s)", name);
                     printf("\n");
                     // flush the stdout puffer, that pipes work without waiting
                     fflush(stdout);
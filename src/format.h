@@ -0,0 +1,98 @@
+#ifndef FORMAT_H
+#define FORMAT_H
+
+#include <stdio.h>
+#include <math.h>
+#include <sml/sml_file.h>
+#include <sml/sml_list.h>
+#include <sml/sml_value.h>
+#include "unit.h"
+#include "obis.h"
+
+// Whether the message is a complete list response, bodies of malformed messages may be missing
+bool is_get_list_response(sml_message *message)
+{
+    return message != NULL && message->message_body != NULL && message->message_body->tag != NULL &&
+           message->message_body->data != NULL && *message->message_body->tag == SML_MESSAGE_GET_LIST_RESPONSE;
+}
+
+// Formats the OBIS identifier of an entry (i.e. "1-0:1.8.0/255")
+bool format_obis(sml_list *entry, char *buffer, size_t size)
+{
+    if (!entry->obj_name || entry->obj_name->len < 6)
+    {
+        return false;
+    }
+    snprintf(buffer, size, "%d-%d:%d.%d.%d/%d",
+             entry->obj_name->str[0], entry->obj_name->str[1],
+             entry->obj_name->str[2], entry->obj_name->str[3],
+             entry->obj_name->str[4], entry->obj_name->str[5]);
+    return true;
+}
+
+// Formats the unit of an entry (i.e. "Wh"), an empty string if there is none
+void format_unit(sml_list *entry, char *buffer, size_t size)
+{
+    if (!entry->unit || !dlms_get_unit((unsigned char)*entry->unit, buffer, size))
+    {
+        buffer[0] = '\0';
+    }
+}
+
+// Formats the human-readable name of an entry (i.e. "Active power"), an empty string if it is unknown
+void format_name(sml_list *entry, char *buffer, size_t size)
+{
+    if (!entry->obj_name || entry->obj_name->len < 6 || !obis_get_name(entry->obj_name->str, buffer, size))
+    {
+        buffer[0] = '\0';
+    }
+}
+
+// Formats an octet string as space separated hex bytes without allocating on the heap
+void format_octet_string(const octet_string *bytes, char *buffer, size_t size)
+{
+    size_t pos = 0;
+    buffer[0] = '\0';
+    for (int i = 0; bytes != NULL && i < bytes->len && (pos + 4) <= size; i++)
+    {
+        pos += snprintf(buffer + pos, size - pos, i > 0 ? " %02x" : "%02x", (unsigned char)bytes->str[i]);
+    }
+}
+
+// Formats the value of an entry, returns false if the entry has no value to be published
+bool format_value(sml_list *entry, bool numeric_only, char *buffer, size_t size)
+{
+    if (!entry->value)
+    { // do not crash on null value
+        return false;
+    }
+    if (((entry->value->type & SML_TYPE_FIELD) == SML_TYPE_INTEGER) ||
+        ((entry->value->type & SML_TYPE_FIELD) == SML_TYPE_UNSIGNED))
+    {
+        double value = sml_value_to_double(entry->value);
+        int scaler = (entry->scaler) ? *entry->scaler : 0;
+        int prec = -scaler;
+        if (prec < 0)
+            prec = 0;
+        value = value * pow(10, scaler);
+        snprintf(buffer, size, "%.*f", prec, value);
+        return true;
+    }
+    if (numeric_only)
+    {
+        return false;
+    }
+    if (entry->value->type == SML_TYPE_OCTET_STRING)
+    {
+        format_octet_string(entry->value->data.bytes, buffer, size);
+        return true;
+    }
+    if (entry->value->type == SML_TYPE_BOOLEAN)
+    {
+        snprintf(buffer, size, "%s", entry->value->data.boolean ? "true" : "false");
+        return true;
+    }
+    return false;
+}
+
+#endif
@@ -5,6 +5,8 @@
 #include "Sensor.h"
 #include <IotWebConf.h>
 #include "MqttPublisher.h"
+#include "StreamPublisher.h"
+#include "SnapshotCoordinator.h"
 #include "EEPROM.h"
 #include <ESP8266WiFi.h>
 #include <ESP8266WebServer.h>
@@ -22,6 +24,11 @@ WiFiClient net;
 
 MqttConfig mqttConfig;
 MqttPublisher publisher;
+// Only allocated if a sensor streams its messages
+StreamPublisher *streamPublisher = NULL;
+StatusLedDriver statusLeds;
+// Only allocated if snapshots are enabled
+SnapshotCoordinator *snapshots = NULL;
 
 IotWebConf iotWebConf(WIFI_AP_SSID, &dnsServer, &server, WIFI_AP_DEFAULT_PASSWORD, CONFIG_VERSION);
 
@@ -33,18 +40,61 @@ iotwebconf::TextParameter mqttTopicParam = iotwebconf::TextParameter("MQTT topic
 iotwebconf::ParameterGroup paramGroup = iotwebconf::ParameterGroup("MQTT Settings", "");
 
 boolean needReset = false;
+boolean publisherEnabled = true;
+unsigned long loopMaxDuration = 0;
+unsigned long lastHeartbeat = 0;
 
-void process_message(byte *buffer, size_t len, Sensor *sensor)
+bool process_message(byte *buffer, size_t len, Sensor *sensor)
 {
-	// Parse
+	// Let the sensor hold back the message until it can be published, unless it is needed for streaming
+	if (publisherEnabled && !publisher.isConnected() && sensor->config->stream == STREAM_NONE)
+	{
+		return false;
+	}
+
+	// Leave the decoding to the consumer
+	if (sensor->config->raw != RAW_NONE)
+	{
+		publisher.publishRaw(sensor, buffer, len);
+		return true;
+	}
+
+	// Parse, skipping the start sequence (8 bytes), end sequence (5 bytes), number of fill bytes (1 byte) and checksum (2 bytes).
+	// The sensor only hands over messages containing all of them (len >= 16), so no length check is needed here.
 	sml_file *file = sml_file_parse(buffer + 8, len - 16);
+	if (file == NULL)
+	{
+		DEBUG("Message could not be parsed, dropping it.");
+		return true;
+	}
 
 	DEBUG_SML_FILE(file);
 
+	// Local consumers first, they are the most latency sensitive
+	if (streamPublisher != NULL)
+	{
+		streamPublisher->publish(sensor, file);
+	}
+
 	publisher.publish(sensor, file);
 
+	if (snapshots != NULL)
+	{
+		snapshots->update(sensor, file);
+	}
+
 	// free the malloc'd memory
 	sml_file_free(file);
+	return true;
+}
+
+void loopSensors()
+{
+	// Execute sensor state machines
+	for (std::list<Sensor*>::iterator it = sensors->begin(); it != sensors->end(); ++it){
+		(*it)->loop();
+	}
+	yield();
 }
 
 void setup()
@@ -52,21 +102,35 @@ void setup()
 	// Setup debugging stuff
 	SERIAL_DEBUG_SETUP(115200);
 
-#ifdef DEBUG
-	// Delay for getting a serial console attached in time
-	delay(2000);
-#endif
-
-	// Setup reading heads
+	// Setup reading heads first, so that they are able to capture messages while the rest is being set up
 	DEBUG("Setting up %d configured sensors...", NUM_OF_SENSORS);
 	const SensorConfig *config = SENSOR_CONFIGS;
 	for (uint8_t i = 0; i < NUM_OF_SENSORS; i++, config++)
 	{
-		Sensor *sensor = new Sensor(config, process_message);
+		Sensor *sensor = new Sensor(config, process_message, &statusLeds);
 		sensors->push_back(sensor);
 	}
+	statusLeds.begin();
 	DEBUG("Sensor setup done.");
 
+	if (StreamPublisher::isUsed(STREAM_UDP) || StreamPublisher::isUsed(STREAM_TCP))
+	{
+		streamPublisher = new StreamPublisher();
+	}
+	if (SNAPSHOT_INTERVAL > 0)
+	{
+		snapshots = new SnapshotCoordinator();
+	}
+
+#ifdef DEBUG
+	// Delay for getting a serial console attached in time, keep the reading heads running meanwhile
+	unsigned long delayStart = millis();
+	while ((millis() - delayStart) < 2000)
+	{
+		loopSensors();
+	}
+#endif
+
 	// Initialize publisher
 	// Setup WiFi and config stuff
 	DEBUG("Setting up WiFi and config stuff.");
@@ -94,10 +158,13 @@ void setup()
 		[](const char *userName, char *password)
 		{ httpUpdater.updateCredentials(userName, password); });
 
+	// Connect right away if the device has already been configured, instead of opening the access point for 30 seconds
+	iotWebConf.skipApStartup();
 	boolean validConfig = iotWebConf.init();
 	if (!validConfig)
 	{
 		DEBUG("Missing or invalid config. MQTT publisher disabled.");
+		publisherEnabled = false;
 	}
 	else
 	{
@@ -114,6 +181,8 @@ void setup()
 
 void loop()
 {
+	unsigned long loopStart = millis();
+
 	if (needReset)
 	{
 		// Doing a chip reset caused by config changes
@@ -122,12 +191,36 @@ void loop()
 		ESP.restart();
 	}
 
-	// Execute sensor state machines
-	for (std::list<Sensor*>::iterator it = sensors->begin(); it != sensors->end(); ++it){
-		(*it)->loop();
+	loopSensors();
+	if (streamPublisher != NULL)
+	{
+		streamPublisher->loop();
+	}
+	statusLeds.set_offline(publisherEnabled && !publisher.isConnected());
+
+	if (snapshots != NULL)
+	{
+		const char *snapshot = snapshots->poll(SNAPSHOT_INTERVAL, SNAPSHOT_INTERPOLATE, SNAPSHOT_MAX_AGE);
+		if (snapshot != NULL)
+		{
+			publisher.snapshot(snapshot);
+		}
+	}
+
+	if (publisher.isConnected() && (millis() - lastHeartbeat) >= (MQTT_HEARTBEAT_INTERVAL * 1000UL))
+	{
+		publisher.heartbeat(sensors, loopMaxDuration, snapshots != NULL ? snapshots->get_drops() : 0);
+		lastHeartbeat = millis();
+		loopMaxDuration = 0;
 	}
 	iotWebConf.doLoop();
 	yield();
+
+	unsigned long loopDuration = millis() - loopStart;
+	if (loopDuration > loopMaxDuration)
+	{
+		loopMaxDuration = loopDuration;
+	}
 }
 
 void configSaved()
@@ -139,5 +232,9 @@ void configSaved()
 void wifiConnected()
 {
 	DEBUG("WiFi connection established.");
+	if (streamPublisher != NULL)
+	{
+		streamPublisher->setup();
+	}
 	publisher.connect();
 }
\ No newline at end of file
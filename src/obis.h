@@ -0,0 +1,110 @@
+// Generated by scripts/generate_obis_names.py, do not edit.
+
+#ifndef OBIS_H
+#define OBIS_H
+
+#include <Arduino.h>
+
+#define OBIS_NAME_MAX_LENGTH 30
+#define OBIS_NAMES_SIZE 61
+
+typedef struct
+{
+    unsigned char c;
+    unsigned char d;
+    unsigned char e;
+    char name[OBIS_NAME_MAX_LENGTH];
+} obis_name_t;
+
+// Perfect hash of the C, D and E groups of an OBIS code
+constexpr unsigned int obis_hash(unsigned char c, unsigned char d, unsigned char e)
+{
+    return (c * 32u + d * 4u + e) % OBIS_NAMES_SIZE;
+}
+
+/**
+ * Static lookup table, indexed by obis_hash()
+ */
+static const obis_name_t obis_names[OBIS_NAMES_SIZE] PROGMEM = {
+    {0, 0, 0, ""}, // 0
+    {81, 7, 4, "Phase angle I-L1/U-L1"}, // 1
+    {0, 0, 0, ""}, // 2
+    {1, 8, 0, "Active energy import"}, // 3
+    {1, 8, 1, "Active energy import tariff 1"}, // 4
+    {1, 8, 2, "Active energy import tariff 2"}, // 5
+    {3, 8, 0, "Reactive energy import"}, // 6
+    {0, 0, 0, ""}, // 7
+    {0, 2, 0, "Firmware version"}, // 8
+    {0, 0, 9, "Device ID"}, // 9
+    {0, 0, 0, ""}, // 10
+    {0, 0, 0, ""}, // 11
+    {81, 7, 15, "Phase angle I-L2/U-L2"}, // 12
+    {51, 7, 0, "Current L2"}, // 13
+    {72, 7, 0, "Voltage L3"}, // 14
+    {32, 7, 0, "Voltage L1"}, // 15
+    {0, 0, 0, ""}, // 16
+    {13, 7, 0, "Power factor"}, // 17
+    {96, 90, 2, "Firmware checksum"}, // 18
+    {0, 0, 0, ""}, // 19
+    {76, 7, 0, "Active power L3"}, // 20
+    {36, 7, 0, "Active power L1"}, // 21
+    {0, 0, 0, ""}, // 22
+    {81, 7, 26, "Phase angle I-L3/U-L3"}, // 23
+    {0, 0, 0, ""}, // 24
+    {0, 0, 0, ""}, // 25
+    {96, 1, 0, "Server ID"}, // 26
+    {0, 0, 0, ""}, // 27
+    {0, 0, 0, ""}, // 28
+    {0, 0, 0, ""}, // 29
+    {0, 0, 0, ""}, // 30
+    {0, 0, 0, ""}, // 31
+    {0, 0, 0, ""}, // 32
+    {0, 0, 0, ""}, // 33
+    {0, 0, 0, ""}, // 34
+    {2, 8, 0, "Active energy export"}, // 35
+    {2, 8, 1, "Active energy export tariff 1"}, // 36
+    {2, 8, 2, "Active energy export tariff 2"}, // 37
+    {4, 8, 0, "Reactive energy export"}, // 38
+    {0, 0, 0, ""}, // 39
+    {96, 50, 1, "Manufacturer"}, // 40
+    {0, 0, 0, ""}, // 41
+    {96, 5, 0, "Operating status"}, // 42
+    {71, 7, 0, "Current L3"}, // 43
+    {31, 7, 0, "Current L1"}, // 44
+    {52, 7, 0, "Voltage L2"}, // 45
+    {0, 0, 0, ""}, // 46
+    {0, 0, 0, ""}, // 47
+    {0, 0, 0, ""}, // 48
+    {14, 7, 0, "Frequency"}, // 49
+    {0, 0, 0, ""}, // 50
+    {56, 7, 0, "Active power L2"}, // 51
+    {16, 7, 0, "Active power"}, // 52
+    {0, 0, 0, ""}, // 53
+    {0, 0, 0, ""}, // 54
+    {0, 0, 0, ""}, // 55
+    {0, 0, 0, ""}, // 56
+    {0, 0, 0, ""}, // 57
+    {0, 0, 0, ""}, // 58
+    {81, 7, 1, "Phase angle U-L2/U-L1"}, // 59
+    {81, 7, 2, "Phase angle U-L3/U-L1"}, // 60
+};
+
+// Copies the name of an electricity related OBIS code (A = 1) to the buffer, returns false if it is unknown
+bool obis_get_name(const unsigned char *obj_name, char *buffer, size_t size)
+{
+    if (obj_name[0] != 1)
+    {
+        return false;
+    }
+    const obis_name_t *it = &obis_names[obis_hash(obj_name[2], obj_name[3], obj_name[4])];
+    if (pgm_read_byte(&it->c) != obj_name[2] || pgm_read_byte(&it->d) != obj_name[3] ||
+        pgm_read_byte(&it->e) != obj_name[4] || pgm_read_byte(&it->name[0]) == 0)
+    {
+        return false;
+    }
+    strncpy_P(buffer, it->name, size - 1);
+    buffer[size - 1] = '\0';
+    return true;
+}
+
+#endif
@@ -23,93 +23,111 @@
  * along with volkszaehler.org. If not, see <http://www.gnu.org/licenses/>.
  */
 
-typedef struct {
-	unsigned char code;
-	const char *unit;
-} dlms_unit_t;
+#ifndef UNIT_H
+#define UNIT_H
+
+#include <Arduino.h>
+
+#define DLMS_UNIT_MAX_LENGTH 11
+#define DLMS_UNITS_SIZE 65
+#define DLMS_SPECIAL_UNITS_OFFSET 253
 
 /**
- * Static lookup table
+ * Static lookup tables placed in flash, indexed by unit code
  */
-dlms_unit_t dlms_units[] = {
-// code, unit		// Quantity			Unit name		SI definition (comment)
+static const char dlms_units[DLMS_UNITS_SIZE][DLMS_UNIT_MAX_LENGTH] PROGMEM = {
+// unit			// code Quantity		Unit name		SI definition (comment)
 //=====================================================================================================
-{1, "a"},		// time				year			52*7*24*60*60 s
-{2, "mo"},		// time				month			31*24*60*60 s
-{3, "wk"},		// time				week			7*24*60*60 s
-{4, "d"},		// time				day			24*60*60 s
-{5, "h"},		// time				hour			60*60 s
-{6, "min."},		// time				min			60 s
-{7, "s"},		// time (t)			second			s
-{8, "°"},		// (phase) angle		degree			rad*180/π
-{9, "°C"},		// temperature (T)		degree celsius		K-273.15
-{10, "currency"},	// (local) currency
-{11, "m"},		// length (l)			metre			m
-{12, "m/s"},		// speed (v)			metre per second	m/s
-{13, "m³"},		// volume (V)			cubic metre		m³
-{14, "m³"},		// corrected volume		cubic metre		m³
-{15, "m³/h"},		// volume flux			cubic metre per hour 	m³/(60*60s)
-{16, "m³/h"},		// corrected volume flux	cubic metre per hour 	m³/(60*60s)
-{17, "m³/d"},		// volume flux						m³/(24*60*60s)
-{18, "m³/d"},		// corrected volume flux				m³/(24*60*60s)
-{19, "l"},		// volume			litre			10-3 m³
-{20, "kg"},		// mass (m)			kilogram
-{21, "N"},		// force (F)			newton
-{22, "Nm"},		// energy			newtonmeter		J = Nm = Ws
-{23, "Pa"},		// pressure (p)			pascal			N/m²
-{24, "bar"},		// pressure (p)			bar			10⁵ N/m²
-{25, "J"},		// energy			joule			J = Nm = Ws
-{26, "J/h"},		// thermal power		joule per hour		J/(60*60s)
-{27, "W"},		// active power (P)		watt			W = J/s
-{28, "VA"},		// apparent power (S)		volt-ampere
-{29, "var"},		// reactive power (Q)		var
-{30, "Wh"},		// active energy		watt-hour		W*(60*60s)
-{31, "VAh"},		// apparent energy		volt-ampere-hour	VA*(60*60s)
-{32, "varh"},		// reactive energy		var-hour		var*(60*60s)
-{33, "A"},		// current (I)			ampere			A
-{34, "C"},		// electrical charge (Q)	coulomb			C = As
-{35, "V"},		// voltage (U)			volt			V
-{36, "V/m"},		// electr. field strength (E)	volt per metre
-{37, "F"},		// capacitance (C)		farad			C/V = As/V
-{38, "Ω"},		// resistance (R)		ohm			Ω = V/A
-{39, "Ωm²/m"},		// resistivity (ρ)		Ωm
-{40, "Wb"},		// magnetic flux (Φ)		weber			Wb = Vs
-{41, "T"},		// magnetic flux density (B)	tesla			Wb/m2
-{42, "A/m"},		// magnetic field strength (H)	ampere per metre	A/m
-{43, "H"},		// inductance (L)		henry			H = Wb/A
-{44, "Hz"},		// frequency (f, ω)		hertz			1/s
-{45, "1/(Wh)"},		// R_W							(Active energy meter constant or pulse value)
-{46, "1/(varh)"},	// R_B							(reactive energy meter constant or pulse value)
-{47, "1/(VAh)"},	// R_S							(apparent energy meter constant or pulse value)
-{48, "V²h"},		// volt-squared hour		volt-squaredhours	V²(60*60s)
-{49, "A²h"},		// ampere-squared hour		ampere-squaredhours	A²(60*60s)
-{50, "kg/s"},		// mass flux			kilogram per second	kg/s
-{51, "S, mho"},		// conductance siemens					1/Ω
-{52, "K"},		// temperature (T)		kelvin
-{53, "1/(V²h)"},	// R_U²h						(Volt-squared hour meter constant or pulse value)
-{54, "1/(A²h)"},	// R_I²h						(Ampere-squared hour meter constant or pulse value)
-{55, "1/m³"},		// R_V, meter constant or pulse value (volume)
-{56, "%"},		// percentage			%
-{57, "Ah"},		// ampere-hours			ampere-hour
-{60, "Wh/m³"},		// energy per volume					3,6*103 J/m³
-{61, "J/m³"},		// calorific value, wobbe
-{62, "Mol %"},		// molar fraction of		mole percent		(Basic gas composition unit)
-			// gas composition  
-{63, "g/m³"},		// mass density, quantity of material			(Gas analysis, accompanying elements)
-{64, "Pa s"},		// dynamic viscosity pascal second			(Characteristic of gas stream)
-{253, "(reserved)"},	// reserved
-{254, "(other)"},	// other unit
-{255, "(unitless)"},	// no unit, unitless, count
-{0, ""}		// stop condition for iterator
+"",		// 0 not defined
+"a",		// 1 time				year			52*7*24*60*60 s
+"mo",		// 2 time				month			31*24*60*60 s
+"wk",		// 3 time				week			7*24*60*60 s
+"d",		// 4 time				day			24*60*60 s
+"h",		// 5 time				hour			60*60 s
+"min.",		// 6 time				min			60 s
+"s",		// 7 time (t)			second			s
+"°",		// 8 (phase) angle		degree			rad*180/π
+"°C",		// 9 temperature (T)		degree celsius		K-273.15
+"currency",	// 10 (local) currency
+"m",		// 11 length (l)			metre			m
+"m/s",		// 12 speed (v)			metre per second	m/s
+"m³",		// 13 volume (V)			cubic metre		m³
+"m³",		// 14 corrected volume		cubic metre		m³
+"m³/h",		// 15 volume flux			cubic metre per hour 	m³/(60*60s)
+"m³/h",		// 16 corrected volume flux	cubic metre per hour 	m³/(60*60s)
+"m³/d",		// 17 volume flux						m³/(24*60*60s)
+"m³/d",		// 18 corrected volume flux				m³/(24*60*60s)
+"l",		// 19 volume			litre			10-3 m³
+"kg",		// 20 mass (m)			kilogram
+"N",		// 21 force (F)			newton
+"Nm",		// 22 energy			newtonmeter		J = Nm = Ws
+"Pa",		// 23 pressure (p)			pascal			N/m²
+"bar",		// 24 pressure (p)			bar			10⁵ N/m²
+"J",		// 25 energy			joule			J = Nm = Ws
+"J/h",		// 26 thermal power		joule per hour		J/(60*60s)
+"W",		// 27 active power (P)		watt			W = J/s
+"VA",		// 28 apparent power (S)		volt-ampere
+"var",		// 29 reactive power (Q)		var
+"Wh",		// 30 active energy		watt-hour		W*(60*60s)
+"VAh",		// 31 apparent energy		volt-ampere-hour	VA*(60*60s)
+"varh",		// 32 reactive energy		var-hour		var*(60*60s)
+"A",		// 33 current (I)			ampere			A
+"C",		// 34 electrical charge (Q)	coulomb			C = As
+"V",		// 35 voltage (U)			volt			V
+"V/m",		// 36 electr. field strength (E)	volt per metre
+"F",		// 37 capacitance (C)		farad			C/V = As/V
+"Ω",		// 38 resistance (R)		ohm			Ω = V/A
+"Ωm²/m",	// 39 resistivity (ρ)		Ωm
+"Wb",		// 40 magnetic flux (Φ)		weber			Wb = Vs
+"T",		// 41 magnetic flux density (B)	tesla			Wb/m2
+"A/m",		// 42 magnetic field strength (H)	ampere per metre	A/m
+"H",		// 43 inductance (L)		henry			H = Wb/A
+"Hz",		// 44 frequency (f, ω)		hertz			1/s
+"1/(Wh)",	// 45 R_W							(Active energy meter constant or pulse value)
+"1/(varh)",	// 46 R_B							(reactive energy meter constant or pulse value)
+"1/(VAh)",	// 47 R_S							(apparent energy meter constant or pulse value)
+"V²h",		// 48 volt-squared hour		volt-squaredhours	V²(60*60s)
+"A²h",		// 49 ampere-squared hour		ampere-squaredhours	A²(60*60s)
+"kg/s",		// 50 mass flux			kilogram per second	kg/s
+"S, mho",	// 51 conductance siemens					1/Ω
+"K",		// 52 temperature (T)		kelvin
+"1/(V²h)",	// 53 R_U²h						(Volt-squared hour meter constant or pulse value)
+"1/(A²h)",	// 54 R_I²h						(Ampere-squared hour meter constant or pulse value)
+"1/m³",		// 55 R_V, meter constant or pulse value (volume)
+"%",		// 56 percentage			%
+"Ah",		// 57 ampere-hours			ampere-hour
+"",		// 58 not defined
+"",		// 59 not defined
+"Wh/m³",	// 60 energy per volume					3,6*103 J/m³
+"J/m³",		// 61 calorific value, wobbe
+"Mol %",	// 62 molar fraction of		mole percent		(Basic gas composition unit)
+"g/m³",		// 63 mass density, quantity of material			(Gas analysis, accompanying elements)
+"Pa s",		// 64 dynamic viscosity pascal second			(Characteristic of gas stream)
+};
+
+static const char dlms_special_units[][DLMS_UNIT_MAX_LENGTH] PROGMEM = {
+"(reserved)",	// 253 reserved
+"(other)",	// 254 other unit
+"(unitless)",	// 255 no unit, unitless, count
 };
-	
-const char * dlms_get_unit(unsigned char code) {
-	dlms_unit_t *it = dlms_units;
-	do { // linear search
-		if (it->code == code) {
-			return it->unit;
-		}
-	} while ((++it)->code);
-	
-	return NULL; // not found
-}
\ No newline at end of file
+
+// Copies the unit to the buffer, returns false if the code is unknown
+bool dlms_get_unit(unsigned char code, char *buffer, size_t size)
+{
+	const char *unit;
+	if (code < DLMS_UNITS_SIZE) {
+		unit = dlms_units[code];
+	} else if (code >= DLMS_SPECIAL_UNITS_OFFSET) {
+		unit = dlms_special_units[code - DLMS_SPECIAL_UNITS_OFFSET];
+	} else {
+		return false;
+	}
+	if (pgm_read_byte(unit) == 0) {
+		return false; // not found
+	}
+	strncpy_P(buffer, unit, size - 1);
+	buffer[size - 1] = '\0';
+	return true;
+}
+
+#endif
@@ -0,0 +1,179 @@
+// Measures the throughput of the framing, decode and publish path on clean and on dirty input.
+// The clean stream repeats the messages of the corpus, the dirty one damages them the way optical
+// reading heads do: flipped bits, lost bytes, noise, truncated and interleaved messages.
+// Fails if dirty input is processed more than --max-slowdown times slower than clean input.
+//
+// Usage: bench_corpus [--bytes=<n>] [--max-slowdown=<factor>] <corpus directory>
+#include "harness.h"
+#include <dirent.h>
+#include <chrono>
+#include <random>
+#include <string>
+
+struct Result
+{
+    size_t bytes = 0;
+    double seconds = 0;
+    double loop_max = 0;
+    SensorMetrics metrics;
+    uint32_t decoded = 0;
+};
+
+static std::vector<std::vector<uint8_t>> read_corpus(const char *path)
+{
+    std::vector<std::vector<uint8_t>> corpus;
+    DIR *dir = opendir(path);
+    if (dir == NULL)
+    {
+        return corpus;
+    }
+    struct dirent *entry;
+    while ((entry = readdir(dir)) != NULL)
+    {
+        if (entry->d_name[0] != '.')
+        {
+            std::vector<uint8_t> data = host::read_file((std::string(path) + "/" + entry->d_name).c_str());
+            if (!data.empty())
+            {
+                corpus.push_back(data);
+            }
+        }
+    }
+    closedir(dir);
+    return corpus;
+}
+
+static std::vector<uint8_t> clean_stream(const std::vector<std::vector<uint8_t>> &corpus, size_t bytes)
+{
+    std::vector<uint8_t> stream;
+    for (size_t i = 0; stream.size() < bytes; i++)
+    {
+        const std::vector<uint8_t> &message = corpus[i % corpus.size()];
+        stream.insert(stream.end(), message.begin(), message.end());
+    }
+    return stream;
+}
+
+static std::vector<uint8_t> dirty_stream(const std::vector<std::vector<uint8_t>> &corpus, size_t bytes)
+{
+    std::mt19937 random(1);
+    std::vector<uint8_t> stream;
+    while (stream.size() < bytes)
+    {
+        std::vector<uint8_t> message = corpus[random() % corpus.size()];
+        switch (random() % 8)
+        {
+        case 0: // Flipped bits
+            for (int i = 1 + random() % 3; i > 0; i--)
+            {
+                message[random() % message.size()] ^= 1 << (random() % 8);
+            }
+            break;
+        case 1: // Lost bytes
+            message.erase(message.begin() + random() % message.size());
+            break;
+        case 2: // Truncated, followed by the next message
+            message.resize(random() % message.size());
+            break;
+        case 3: // Noise in front of the message
+            for (int i = 1 + random() % 64; i > 0; i--)
+            {
+                stream.push_back(random());
+            }
+            break;
+        case 4: // Interleaved with the beginning of another message
+        {
+            const std::vector<uint8_t> &other = corpus[random() % corpus.size()];
+            size_t pos = random() % message.size();
+            message.insert(message.begin() + pos, other.begin(), other.begin() + random() % other.size());
+            break;
+        }
+        default: // Intact
+            break;
+        }
+        stream.insert(stream.end(), message.begin(), message.end());
+    }
+    return stream;
+}
+
+static Result run(const std::vector<uint8_t> &stream)
+{
+    Result result;
+    host::decoded = 0;
+    host::Pipeline pipeline(SENSOR_CONFIGS, 1);
+    Sensor *sensor = pipeline.get_sensors().front();
+
+    // Transmit in chunks, so that the line of the serial stand-in stays short
+    const size_t chunk = 4096;
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    for (size_t pos = 0; pos < stream.size() + chunk; pos += chunk)
+    {
+        // The last iteration only processes the message completed by the last chunk
+        if (pos < stream.size())
+        {
+            pipeline.transmit(stream.data() + pos, std::min(chunk, stream.size() - pos));
+        }
+        do
+        {
+            host_advance(10000);
+            std::chrono::steady_clock::time_point loop_start = std::chrono::steady_clock::now();
+            pipeline.loop();
+            result.loop_max = std::max(result.loop_max, std::chrono::duration<double>(std::chrono::steady_clock::now() - loop_start).count());
+        } while (!pipeline.idle());
+    }
+    result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    result.bytes = stream.size();
+    result.metrics = sensor->get_metrics();
+    result.decoded = host::decoded;
+    return result;
+}
+
+static void print(const char *name, const Result &result)
+{
+    printf("%-6s %9zu bytes %7.3f s %8.1f KiB/s  loop_max %6.0f us  started %6u frames %6u decoded %6u crc_errors %5u malformed %4u overflows %3u\n",
+           name, result.bytes, result.seconds, result.bytes / result.seconds / 1024, result.loop_max * 1e6,
+           result.metrics.started, result.metrics.frames, result.decoded, result.metrics.crc_errors,
+           result.metrics.malformed, result.metrics.overflows);
+}
+
+int main(int argc, char **argv)
+{
+    size_t bytes = 4 * 1024 * 1024;
+    double max_slowdown = 4;
+    const char *path = NULL;
+    for (int i = 1; i < argc; i++)
+    {
+        if (strncmp(argv[i], "--bytes=", 8) == 0)
+        {
+            bytes = strtoul(argv[i] + 8, NULL, 10);
+        }
+        else if (strncmp(argv[i], "--max-slowdown=", 15) == 0)
+        {
+            max_slowdown = atof(argv[i] + 15);
+        }
+        else
+        {
+            path = argv[i];
+        }
+    }
+    std::vector<std::vector<uint8_t>> corpus = path != NULL ? read_corpus(path) : std::vector<std::vector<uint8_t>>();
+    if (corpus.empty())
+    {
+        fprintf(stderr, "Usage: %s [--bytes=<n>] [--max-slowdown=<factor>] <corpus directory>\n", argv[0]);
+        return 1;
+    }
+
+    Result clean = run(clean_stream(corpus, bytes));
+    print("clean", clean);
+    Result dirty = run(dirty_stream(corpus, bytes));
+    print("dirty", dirty);
+
+    double slowdown = (dirty.seconds / dirty.bytes) / (clean.seconds / clean.bytes);
+    printf("Dirty input takes %.2f times as long per byte as clean input (limit %.1f).\n", slowdown, max_slowdown);
+    if (clean.metrics.frames != clean.decoded || clean.metrics.crc_errors > 0 || clean.metrics.malformed > 0)
+    {
+        printf("Clean input has not been decoded completely.\n");
+        return 1;
+    }
+    return slowdown > max_slowdown ? 1 : 0;
+}
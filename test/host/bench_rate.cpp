@@ -0,0 +1,144 @@
+// Sends messages to a single reading head at fixed rates and counts the ones that do not get published.
+// Time is virtual: every iteration of the main loop takes --loop-ms for the work besides the sensor
+// (WiFi, MQTT, web server) and every message takes --process-ms for parsing and publishing, which is
+// what the serial receive buffer has to bridge on the device.
+// For every rate, the largest message of the corpus that fits into the period at 9600 Baud is sent.
+// Fails if a message is lost at --require-hz or below.
+//
+// Usage: bench_rate [--seconds=<n>] [--loop-ms=<n>] [--process-ms=<n>] [--require-hz=<n>] <corpus directory>
+#include "harness.h"
+#include <dirent.h>
+#include <string>
+
+// Bytes per second at 9600 Baud with 10 bits per byte
+#define LINE_RATE 960
+
+struct Result
+{
+    uint32_t sent = 0;
+    uint32_t decoded = 0;
+    size_t peak = 0;
+    size_t bytes_lost = 0;
+    SensorMetrics metrics;
+};
+
+static std::vector<uint8_t> largest_message(const char *path, size_t max_len)
+{
+    std::vector<uint8_t> largest;
+    DIR *dir = opendir(path);
+    if (dir == NULL)
+    {
+        return largest;
+    }
+    struct dirent *entry;
+    while ((entry = readdir(dir)) != NULL)
+    {
+        if (entry->d_name[0] != '.')
+        {
+            std::vector<uint8_t> data = host::read_file((std::string(path) + "/" + entry->d_name).c_str());
+            if (data.size() <= max_len && data.size() > largest.size())
+            {
+                largest = data;
+            }
+        }
+    }
+    closedir(dir);
+    return largest;
+}
+
+static Result run(const std::vector<uint8_t> &message, uint32_t hz, uint32_t seconds, uint64_t loop_micros)
+{
+    Result result;
+    host::decoded = 0;
+    host::Pipeline pipeline(SENSOR_CONFIGS, 1);
+    Sensor *sensor = pipeline.get_sensors().front();
+    SoftwareSerial *serial = SoftwareSerial::on_pin(sensor->config->pin);
+
+    uint64_t start = host_micros();
+    uint64_t period = 1000000ULL / hz;
+    for (uint32_t i = 0; i < seconds * hz; i++)
+    {
+        serial->transmit(message.data(), message.size(), start + i * period);
+        result.sent++;
+    }
+    while (!pipeline.idle())
+    {
+        host_advance(loop_micros);
+        pipeline.loop();
+    }
+    // A message completed by the last bytes is processed in the next iteration
+    host_advance(loop_micros);
+    pipeline.loop();
+
+    result.decoded = host::decoded;
+    result.peak = serial->peak();
+    result.bytes_lost = serial->lost();
+    result.metrics = sensor->get_metrics();
+    return result;
+}
+
+int main(int argc, char **argv)
+{
+    uint32_t seconds = 60;
+    uint64_t loop_micros = 10000;
+    uint32_t require_hz = 4;
+    const char *path = NULL;
+    host::processingMicros = 50000;
+    for (int i = 1; i < argc; i++)
+    {
+        if (strncmp(argv[i], "--seconds=", 10) == 0)
+        {
+            seconds = strtoul(argv[i] + 10, NULL, 10);
+        }
+        else if (strncmp(argv[i], "--loop-ms=", 10) == 0)
+        {
+            loop_micros = strtoul(argv[i] + 10, NULL, 10) * 1000;
+        }
+        else if (strncmp(argv[i], "--process-ms=", 13) == 0)
+        {
+            host::processingMicros = strtoul(argv[i] + 13, NULL, 10) * 1000;
+        }
+        else if (strncmp(argv[i], "--require-hz=", 13) == 0)
+        {
+            require_hz = strtoul(argv[i] + 13, NULL, 10);
+        }
+        else
+        {
+            path = argv[i];
+        }
+    }
+    if (path == NULL)
+    {
+        fprintf(stderr, "Usage: %s [--seconds=<n>] [--loop-ms=<n>] [--process-ms=<n>] [--require-hz=<n>] <corpus directory>\n", argv[0]);
+        return 1;
+    }
+
+    printf("Serial receive buffer %d bytes, main loop %lu ms, processing %lu ms per message, %u s per rate\n",
+           SERIAL_BUFFER_SIZE, (unsigned long)(loop_micros / 1000), (unsigned long)(host::processingMicros / 1000), seconds);
+    const uint32_t rates[] = {1, 2, 4, 6, 8};
+    bool failed = false;
+    for (size_t i = 0; i < sizeof(rates) / sizeof(rates[0]); i++)
+    {
+        std::vector<uint8_t> message = largest_message(path, LINE_RATE / rates[i]);
+        if (message.empty())
+        {
+            printf("%2u Hz: no message of the corpus fits into %u bytes\n", rates[i], LINE_RATE / rates[i]);
+            continue;
+        }
+        Result result = run(message, rates[i], seconds, loop_micros);
+        uint32_t lost = result.sent - result.decoded;
+        printf("%2u Hz: %3zu bytes (line %3zu%% busy)  sent %4u decoded %4u lost %4u  serial peak %3zu lost %5zu bytes  crc_errors %3u malformed %3u serial_overflows %3u\n",
+               rates[i], message.size(), message.size() * rates[i] * 100 / LINE_RATE, result.sent, result.decoded, lost,
+               result.peak, result.bytes_lost, result.metrics.crc_errors, result.metrics.malformed, result.metrics.serial_overflows);
+        if (rates[i] <= require_hz && lost > 0)
+        {
+            failed = true;
+        }
+    }
+    if (failed)
+    {
+        printf("Messages have been lost at %u Hz or below.\n", require_hz);
+        return 1;
+    }
+    return 0;
+}
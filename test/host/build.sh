@@ -0,0 +1,56 @@
+#!/bin/sh
+# Builds the host harness into test/host/build:
+# - fuzz_sensor: libFuzzer target if the compiler supports it (clang), a standalone driver otherwise,
+#   both with AddressSanitizer and UndefinedBehaviorSanitizer
+# - bench_corpus: optimized benchmark on clean and dirty input
+# - bench_rate: loss of messages sent at fixed rates
+# - corpus: seed corpus generated by make_corpus.py
+#
+# libsml is cloned from GitHub, unless LIBSML_DIR points to a checkout.
+# The compilers can be selected via CC and CXX, i.e. CC=clang CXX=clang++ ./build.sh
+set -e
+
+cd "$(dirname "$0")"
+BUILD_DIR=build
+LIBSML_DIR=${LIBSML_DIR:-$BUILD_DIR/libsml}
+CC=${CC:-cc}
+CXX=${CXX:-c++}
+SANITIZE="-fsanitize=address,undefined -fno-sanitize-recover=undefined -fno-omit-frame-pointer -g -O1"
+
+mkdir -p "$BUILD_DIR"
+if [ ! -d "$LIBSML_DIR" ]; then
+    git clone --depth 1 https://github.com/volkszaehler/libsml "$LIBSML_DIR"
+fi
+python3 make_corpus.py "$BUILD_DIR/corpus"
+
+INCLUDES="-Istubs -I. -I../../src -I$LIBSML_DIR/sml/include"
+CXXFLAGS="-std=gnu++11 -Wall -Wno-unused-variable -Wno-unused-but-set-variable -Wno-unused-function $INCLUDES"
+
+# Compiles libsml with the given flags into the given directory
+build_libsml() {
+    mkdir -p "$1"
+    for source in "$LIBSML_DIR"/sml/src/*.c; do
+        # The transport reads from file descriptors and is not used by SMLReader
+        case "$source" in *sml_transport.c) continue ;; esac
+        $CC -c $2 -DSML_NO_UUID_LIB -I"$LIBSML_DIR/sml/include" "$source" -o "$1/$(basename "$source" .c).o"
+    done
+}
+
+build_libsml "$BUILD_DIR/libsml-sanitize" "$SANITIZE"
+build_libsml "$BUILD_DIR/libsml-release" "-O2"
+
+if echo 'extern "C" int LLVMFuzzerTestOneInput(const char *d, unsigned long s) { return 0; }' |
+    $CXX -x c++ -fsanitize=fuzzer - -o "$BUILD_DIR/fuzzer_check" 2>/dev/null; then
+    echo "Building fuzz_sensor with libFuzzer"
+    $CXX $CXXFLAGS $SANITIZE -fsanitize=fuzzer fuzz_sensor.cpp "$BUILD_DIR"/libsml-sanitize/*.o -o "$BUILD_DIR/fuzz_sensor"
+else
+    echo "Building fuzz_sensor with the standalone driver, libFuzzer is not available"
+    $CXX $CXXFLAGS $SANITIZE fuzz_sensor.cpp fuzz_main.cpp "$BUILD_DIR"/libsml-sanitize/*.o -o "$BUILD_DIR/fuzz_sensor"
+fi
+rm -f "$BUILD_DIR/fuzzer_check"
+
+echo "Building bench_corpus"
+$CXX $CXXFLAGS -O2 bench_corpus.cpp "$BUILD_DIR"/libsml-release/*.o -o "$BUILD_DIR/bench_corpus"
+
+echo "Building bench_rate"
+$CXX $CXXFLAGS -O2 bench_rate.cpp "$BUILD_DIR"/libsml-release/*.o -o "$BUILD_DIR/bench_rate"
@@ -0,0 +1,216 @@
+// Standalone driver for fuzz_sensor.cpp, used if the compiler does not provide libFuzzer.
+// Runs every file of the corpus and then the given number of inputs derived from them by random
+// mutations, which resemble the defects of optical reading heads: flipped bits, lost and inserted
+// bytes, truncated messages and messages interleaved with each other.
+//
+// If an input makes a sanitizer abort, it is written to crash-input for replaying it.
+//
+// Usage: fuzz_sensor [-runs=<n>] [-seed=<n>] <corpus file or directory>...
+#include <dirent.h>
+#include <sanitizer/common_interface_defs.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <chrono>
+#include <random>
+#include <string>
+#include <vector>
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size);
+
+static const std::vector<std::vector<uint8_t>> TOKENS = {
+    {0x1b, 0x1b, 0x1b, 0x1b, 0x01, 0x01, 0x01, 0x01},
+    {0x1b, 0x1b, 0x1b, 0x1b, 0x1a},
+    {0x1b, 0x1b, 0x1b, 0x1b},
+    {0x76},
+    {0x77},
+    {0x01},
+    {0x00},
+};
+
+// Input that is currently running
+static const std::vector<uint8_t> *current = NULL;
+
+static void write_current()
+{
+    FILE *file = fopen("crash-input", "wb");
+    if (file != NULL && current != NULL)
+    {
+        fwrite(current->data(), 1, current->size(), file);
+        fprintf(stderr, "Input written to crash-input\n");
+    }
+    if (file != NULL)
+    {
+        fclose(file);
+    }
+}
+
+static std::vector<uint8_t> read_file(const std::string &path)
+{
+    std::vector<uint8_t> data;
+    FILE *file = fopen(path.c_str(), "rb");
+    if (file == NULL)
+    {
+        return data;
+    }
+    uint8_t buffer[4096];
+    size_t len;
+    while ((len = fread(buffer, 1, sizeof(buffer), file)) > 0)
+    {
+        data.insert(data.end(), buffer, buffer + len);
+    }
+    fclose(file);
+    return data;
+}
+
+static void add_inputs(const std::string &path, std::vector<std::vector<uint8_t>> &inputs)
+{
+    struct stat info;
+    if (stat(path.c_str(), &info) != 0)
+    {
+        fprintf(stderr, "Cannot read %s\n", path.c_str());
+        exit(1);
+    }
+    if (!S_ISDIR(info.st_mode))
+    {
+        inputs.push_back(read_file(path));
+        return;
+    }
+    DIR *dir = opendir(path.c_str());
+    struct dirent *entry;
+    while ((entry = readdir(dir)) != NULL)
+    {
+        if (entry->d_name[0] != '.')
+        {
+            add_inputs(path + "/" + entry->d_name, inputs);
+        }
+    }
+    closedir(dir);
+}
+
+static void mutate(std::vector<uint8_t> &data, const std::vector<std::vector<uint8_t>> &inputs, std::mt19937 &random)
+{
+    int mutations = 1 + random() % 8;
+    for (int i = 0; i < mutations; i++)
+    {
+        size_t pos = data.empty() ? 0 : random() % (data.size() + 1);
+        switch (random() % 8)
+        {
+        case 0: // Flip a bit
+            if (!data.empty())
+            {
+                data[random() % data.size()] ^= 1 << (random() % 8);
+            }
+            break;
+        case 1: // Replace a byte
+            if (!data.empty())
+            {
+                data[random() % data.size()] = random();
+            }
+            break;
+        case 2: // Lose some bytes
+        {
+            size_t len = std::min<size_t>(data.size() - pos, 1 + random() % 32);
+            data.erase(data.begin() + pos, data.begin() + pos + len);
+            break;
+        }
+        case 3: // Insert noise
+        {
+            size_t len = 1 + random() % 32;
+            for (size_t j = 0; j < len; j++)
+            {
+                data.insert(data.begin() + pos, (uint8_t)random());
+            }
+            break;
+        }
+        case 4: // Truncate
+            data.resize(pos);
+            break;
+        case 5: // Insert a token of the framing or encoding
+        {
+            const std::vector<uint8_t> &token = TOKENS[random() % TOKENS.size()];
+            data.insert(data.begin() + pos, token.begin(), token.end());
+            break;
+        }
+        case 6: // Interleave with the beginning or the end of another input
+        {
+            const std::vector<uint8_t> &other = inputs[random() % inputs.size()];
+            size_t cut = other.empty() ? 0 : random() % other.size();
+            if (random() % 2)
+            {
+                data.insert(data.begin() + pos, other.begin(), other.begin() + cut);
+            }
+            else
+            {
+                data.insert(data.begin() + pos, other.begin() + cut, other.end());
+            }
+            break;
+        }
+        case 7: // Repeat a part
+            if (pos < data.size())
+            {
+                size_t len = std::min<size_t>(data.size() - pos, 1 + random() % 64);
+                std::vector<uint8_t> part(data.begin() + pos, data.begin() + pos + len);
+                data.insert(data.begin() + pos, part.begin(), part.end());
+            }
+            break;
+        }
+    }
+    // Keep the inputs within the size of a few messages
+    if (data.size() > 16384)
+    {
+        data.resize(16384);
+    }
+}
+
+int main(int argc, char **argv)
+{
+    unsigned long runs = 100000;
+    unsigned long seed = 1;
+    std::vector<std::vector<uint8_t>> inputs;
+    for (int i = 1; i < argc; i++)
+    {
+        if (strncmp(argv[i], "-runs=", 6) == 0)
+        {
+            runs = strtoul(argv[i] + 6, NULL, 10);
+        }
+        else if (strncmp(argv[i], "-seed=", 6) == 0)
+        {
+            seed = strtoul(argv[i] + 6, NULL, 10);
+        }
+        else
+        {
+            add_inputs(argv[i], inputs);
+        }
+    }
+    if (inputs.empty())
+    {
+        fprintf(stderr, "Usage: %s [-runs=<n>] [-seed=<n>] <corpus file or directory>...\n", argv[0]);
+        return 1;
+    }
+
+    __sanitizer_set_death_callback(write_current);
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < inputs.size(); i++)
+    {
+        current = &inputs[i];
+        LLVMFuzzerTestOneInput(inputs[i].data(), inputs[i].size());
+    }
+
+    std::mt19937 random(seed);
+    size_t bytes = 0;
+    for (unsigned long i = 0; i < runs; i++)
+    {
+        std::vector<uint8_t> data = inputs[random() % inputs.size()];
+        mutate(data, inputs, random);
+        bytes += data.size();
+        current = &data;
+        LLVMFuzzerTestOneInput(data.data(), data.size());
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    fprintf(stderr, "Done: %zu corpus inputs and %lu mutated inputs (%zu bytes) in %.1f s, seed %lu\n",
+            inputs.size(), runs, bytes, seconds, seed);
+    return 0;
+}
@@ -0,0 +1,28 @@
+// Fuzz target feeding arbitrary bytes to the reading heads, as if they had been received from the meter.
+// Every head runs the framing of Sensor and its way of publishing (decoded, numeric only or raw),
+// decoded messages are parsed by libsml, printed, streamed, published and added to snapshots.
+#include "harness.h"
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size)
+{
+    static bool initialized = false;
+    if (!initialized)
+    {
+        // Printing decoded messages is part of the decode path, the output is of no interest though
+        freopen("/dev/null", "w", stdout);
+        host::printFiles = true;
+        initialized = true;
+    }
+
+    host::Pipeline pipeline(SENSOR_CONFIGS, NUM_OF_SENSORS);
+    // Let a third of the inputs be held back until the connection has been established
+    pipeline.set_online(size % 3 != 0);
+    pipeline.transmit(data, size);
+    pipeline.run(4000);
+    pipeline.set_online(true);
+    pipeline.loop();
+    // Let incomplete messages time out
+    host_advance((READ_TIMEOUT + 1) * 1000000ULL);
+    pipeline.loop();
+    return 0;
+}
@@ -0,0 +1,206 @@
+// Runs reading heads and the decode and publish path of SMLReader on the host.
+// The platform libraries are replaced by the stand-ins in stubs/, libsml is the real one.
+#ifndef HOST_HARNESS_H
+#define HOST_HARNESS_H
+
+#include "host_config.h"
+#include <assert.h>
+#include <list>
+#include <vector>
+#include "debug.h"
+#include "MqttPublisher.h"
+#include "StreamPublisher.h"
+#include "SnapshotCoordinator.h"
+
+namespace host
+{
+    // Counterparts of the globals in src/main.cpp
+    MqttPublisher publisher;
+    StreamPublisher *streamPublisher = NULL;
+    SnapshotCoordinator *snapshots = NULL;
+    // Never destroyed, like on the device, where the LEDs it hands out live as long as the sensors
+    StatusLedDriver &statusLeds = *new StatusLedDriver();
+    bool publisherEnabled = true;
+
+    // Whether decoded messages are printed like in debug builds
+    bool printFiles = false;
+    // Simulated processing time of a message on the device in microseconds, charged to the virtual clock
+    uint64_t processingMicros = 0;
+    uint32_t decoded = 0;
+
+    // Mirrors process_message() in src/main.cpp
+    bool process_message(byte *buffer, size_t len, Sensor *sensor)
+    {
+        if (publisherEnabled && !publisher.isConnected() && sensor->config->stream == STREAM_NONE)
+        {
+            return false;
+        }
+
+        host_advance(processingMicros);
+
+        if (sensor->config->raw != RAW_NONE)
+        {
+            publisher.publishRaw(sensor, buffer, len);
+            return true;
+        }
+
+        // The length check that src/main.cpp omits
+        assert(len >= 16);
+
+        sml_file *file = sml_file_parse(buffer + 8, len - 16);
+        if (file == NULL)
+        {
+            return true;
+        }
+
+        if (printFiles)
+        {
+            DEBUG_SML_FILE(file);
+        }
+
+        if (streamPublisher != NULL)
+        {
+            streamPublisher->publish(sensor, file);
+        }
+        publisher.publish(sensor, file);
+        if (snapshots != NULL)
+        {
+            snapshots->update(sensor, file);
+        }
+
+        sml_file_free(file);
+        decoded++;
+        return true;
+    }
+
+    class Pipeline
+    {
+    public:
+        // Sets up the sensors of the given configs, all of them receive the same data
+        Pipeline(const SensorConfig *configs, uint8_t count)
+        {
+            static bool publisherSetUp = false;
+            if (!publisherSetUp)
+            {
+                MqttConfig config;
+                publisher.setup(config);
+                publisherSetUp = true;
+            }
+            publisher.connect();
+
+            for (uint8_t i = 0; i < count; i++)
+            {
+                this->sensors.push_back(new Sensor(&configs[i], process_message, &statusLeds));
+            }
+            streamPublisher = new StreamPublisher();
+            streamPublisher->setup();
+            this->client = AsyncServer::connect_client();
+            snapshots = new SnapshotCoordinator();
+        }
+
+        ~Pipeline()
+        {
+            if (this->client != NULL)
+            {
+                this->client->close(true);
+            }
+            for (std::list<Sensor *>::iterator it = this->sensors.begin(); it != this->sensors.end(); ++it)
+            {
+                delete *it;
+            }
+            delete streamPublisher;
+            streamPublisher = NULL;
+            delete snapshots;
+            snapshots = NULL;
+        }
+
+        void set_online(bool online)
+        {
+            if (online)
+            {
+                publisher.connect();
+            }
+            else
+            {
+                publisher.disconnect();
+            }
+        }
+
+        // Sends the data to all sensors at 9600 Baud, starting as soon as the line is free
+        void transmit(const uint8_t *data, size_t len)
+        {
+            for (std::list<Sensor *>::iterator it = this->sensors.begin(); it != this->sensors.end(); ++it)
+            {
+                SoftwareSerial::on_pin((*it)->config->pin)->transmit(data, len, host_micros());
+            }
+        }
+
+        // One iteration of the main loop
+        void loop()
+        {
+            for (std::list<Sensor *>::iterator it = this->sensors.begin(); it != this->sensors.end(); ++it)
+            {
+                (*it)->loop();
+            }
+            const char *snapshot = snapshots->poll(SNAPSHOT_INTERVAL, SNAPSHOT_INTERPOLATE, SNAPSHOT_MAX_AGE);
+            if (snapshot != NULL)
+            {
+                publisher.snapshot(snapshot);
+            }
+        }
+
+        // Runs the main loop every step microseconds until all data sent has been read and processed
+        void run(uint64_t step)
+        {
+            while (!this->idle())
+            {
+                host_advance(step);
+                this->loop();
+            }
+            // A message completed by the last bytes is processed in the next iteration
+            host_advance(step);
+            this->loop();
+        }
+
+        bool idle()
+        {
+            for (std::list<Sensor *>::iterator it = this->sensors.begin(); it != this->sensors.end(); ++it)
+            {
+                if (!SoftwareSerial::on_pin((*it)->config->pin)->idle())
+                {
+                    return false;
+                }
+            }
+            return true;
+        }
+
+        std::list<Sensor *> &get_sensors()
+        {
+            return this->sensors;
+        }
+
+    private:
+        std::list<Sensor *> sensors;
+        AsyncClient *client = NULL;
+    };
+
+    std::vector<uint8_t> read_file(const char *path)
+    {
+        std::vector<uint8_t> data;
+        FILE *file = fopen(path, "rb");
+        if (file == NULL)
+        {
+            return data;
+        }
+        uint8_t buffer[4096];
+        size_t len;
+        while ((len = fread(buffer, 1, sizeof(buffer), file)) > 0)
+        {
+            data.insert(data.end(), buffer, buffer + len);
+        }
+        fclose(file);
+        return data;
+    }
+}
+
+#endif
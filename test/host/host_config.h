@@ -0,0 +1,46 @@
+// Replaces src/config.h for the host harness, it has to be included before any header of SMLReader
+#ifndef CONFIG_H
+#define CONFIG_H
+
+#include "Arduino.h"
+#include "Sensor.h"
+
+const char *VERSION = "host";
+
+// One sensor per way of publishing, all of them are fed the same input
+static const SensorConfig SENSOR_CONFIGS[] = {
+    {.pin = 1,
+     .name = "decoded",
+     .numeric_only = false,
+     .status_led_enabled = true,
+     .status_led_inverted = true,
+     .status_led_pin = LED_BUILTIN,
+     .interval = 0,
+     .stream = STREAM_TCP,
+     .raw = RAW_NONE},
+    {.pin = 2,
+     .name = "numeric",
+     .numeric_only = true,
+     .status_led_enabled = true,
+     .status_led_inverted = true,
+     .status_led_pin = LED_BUILTIN,
+     .interval = 0,
+     .stream = STREAM_NONE,
+     .raw = RAW_NONE},
+    {.pin = 3,
+     .name = "raw",
+     .numeric_only = false,
+     .status_led_enabled = false,
+     .status_led_inverted = false,
+     .status_led_pin = 0,
+     .interval = 1,
+     .stream = STREAM_NONE,
+     .raw = RAW_PACKBITS}};
+
+const uint8_t NUM_OF_SENSORS = sizeof(SENSOR_CONFIGS) / sizeof(SensorConfig);
+
+const unsigned long SNAPSHOT_INTERVAL = 100;
+const bool SNAPSHOT_INTERPOLATE = true;
+const unsigned long SNAPSHOT_MAX_AGE = 2 * SNAPSHOT_INTERVAL;
+
+#endif
@@ -0,0 +1,224 @@
+#!/usr/bin/env python3
+"""
+Generates the seed corpus for the host harness: complete SML transport frames
+(start sequence, messages, padding, end sequence and checksum) modeled on the
+messages of common meters.
+
+Captures of real meters can be added to the corpus directory as well, i.e. by
+converting the output of a build with SERIAL_DEBUG_VERBOSE=true using
+"xxd -r -p".
+
+Usage:
+    make_corpus.py <output_dir>
+"""
+import os
+import struct
+import sys
+
+START_SEQUENCE = b"\x1b\x1b\x1b\x1b\x01\x01\x01\x01"
+ESCAPE = b"\x1b\x1b\x1b\x1b"
+
+OPEN_RESPONSE = 0x0101
+CLOSE_RESPONSE = 0x0201
+GET_LIST_RESPONSE = 0x0701
+
+# DLMS unit codes
+WH = 30
+W = 27
+V = 35
+A = 33
+HZ = 44
+
+
+def crc16(data):
+    """CRC16/X.25 as used by SML"""
+    crc = 0xFFFF
+    for byte in data:
+        crc ^= byte
+        for _ in range(8):
+            crc = (crc >> 1) ^ 0x8408 if crc & 1 else crc >> 1
+    return crc ^ 0xFFFF
+
+
+def tl(type_bits, length):
+    """Type-length field, the length includes the field itself for all types but lists"""
+    if type_bits != 0x70:
+        length += 1
+        if length > 0x0F:
+            length += 1
+    if length <= 0x0F:
+        return bytes([type_bits | length])
+    return bytes([0x80 | type_bits | (length >> 4), length & 0x0F])
+
+
+def octets(data):
+    return tl(0x00, len(data)) + data
+
+
+def unsigned(value, size):
+    return tl(0x60, size) + value.to_bytes(size, "big")
+
+
+def integer(value, size):
+    return tl(0x50, size) + value.to_bytes(size, "big", signed=True)
+
+
+def boolean(value):
+    return tl(0x40, 1) + (b"\x01" if value else b"\x00")
+
+
+def sml_list(*items):
+    return tl(0x70, len(items)) + b"".join(items)
+
+
+SKIPPED = b"\x01"
+
+
+def obis(a, b, c, d, e, f):
+    return octets(bytes([a, b, c, d, e, f]))
+
+
+def entry(name, value, unit=None, scaler=None, status=None, time=None):
+    return sml_list(
+        obis(*name),
+        status if status is not None else SKIPPED,
+        time if time is not None else SKIPPED,
+        unsigned(unit, 1) if unit is not None else SKIPPED,
+        integer(scaler, 1) if scaler is not None else SKIPPED,
+        value,
+        SKIPPED,
+    )
+
+
+def sec_index(seconds):
+    return sml_list(unsigned(1, 1), unsigned(seconds, 4))
+
+
+def message(transaction, tag, body):
+    # A message is a list of 6 elements, the checksum covers the elements preceding it
+    data = tl(0x70, 6) + octets(transaction) + unsigned(0, 1) + unsigned(0, 1) + sml_list(unsigned(tag, 2), body)
+    return data + unsigned(crc16(data), 2) + b"\x00"
+
+
+def open_response(server_id):
+    return message(b"\x00\x01", OPEN_RESPONSE,
+                   sml_list(SKIPPED, SKIPPED, octets(b"\x0a\x0b\x0c\x0d\x0e\x0f"), octets(server_id), SKIPPED, SKIPPED))
+
+
+def get_list_response(server_id, entries, sensor_time=None):
+    return message(b"\x00\x02", GET_LIST_RESPONSE,
+                   sml_list(SKIPPED, octets(server_id), octets(b"\x01\x00\x62\x0a\xff\xff"),
+                            sec_index(sensor_time) if sensor_time is not None else SKIPPED,
+                            sml_list(*entries), SKIPPED, SKIPPED))
+
+
+def close_response():
+    return message(b"\x00\x03", CLOSE_RESPONSE, sml_list(SKIPPED))
+
+
+def escape(payload):
+    """Escapes every occurrence of the escape sequence at a 4 byte boundary of the frame"""
+    out = b""
+    for i in range(0, len(payload), 4):
+        chunk = payload[i:i + 4]
+        out += chunk + (ESCAPE if chunk == ESCAPE else b"")
+    return out
+
+
+def frame(*messages):
+    payload = b"".join(messages)
+    fill = (4 - (len(START_SEQUENCE) + len(payload)) % 4) % 4
+    data = START_SEQUENCE + escape(payload + b"\x00" * fill) + ESCAPE + bytes([0x1A, fill])
+    crc = crc16(data)
+    return data + struct.pack("<H", crc)
+
+
+SERVER_ID = b"\x0a\x01\x45\x4d\x48\x00\x00\x7a\xc5\x42"
+
+
+def basic():
+    return frame(
+        open_response(SERVER_ID),
+        get_list_response(SERVER_ID, [
+            entry((129, 129, 199, 130, 3, 255), octets(b"EMH")),
+            entry((1, 0, 0, 0, 9, 255), octets(SERVER_ID)),
+            entry((1, 0, 1, 8, 0, 255), unsigned(35462459, 8), WH, -1, status=unsigned(0x182, 2)),
+            entry((1, 0, 2, 8, 0, 255), unsigned(132, 8), WH, -1),
+            entry((1, 0, 1, 8, 1, 255), unsigned(0, 8), WH, -1),
+            entry((1, 0, 1, 8, 2, 255), unsigned(35462459, 8), WH, -1),
+            entry((1, 0, 16, 7, 0, 255), integer(4512, 4), W, -1),
+            entry((129, 129, 199, 130, 5, 255), octets(bytes(range(0x20, 0x50)))),
+        ]),
+        close_response())
+
+
+def high_resolution():
+    return frame(
+        open_response(SERVER_ID),
+        get_list_response(SERVER_ID, [
+            entry((1, 0, 1, 8, 0, 255), unsigned(1234567890123, 8), WH, -4, time=sec_index(5000)),
+            entry((1, 0, 16, 7, 0, 255), integer(-81253, 4), W, -2),
+            entry((1, 0, 36, 7, 0, 255), integer(-27012, 4), W, -2),
+            entry((1, 0, 56, 7, 0, 255), integer(-27118, 4), W, -2),
+            entry((1, 0, 76, 7, 0, 255), integer(-27123, 4), W, -2),
+            entry((1, 0, 32, 7, 0, 255), unsigned(2301, 2), V, -1),
+            entry((1, 0, 52, 7, 0, 255), unsigned(2298, 2), V, -1),
+            entry((1, 0, 72, 7, 0, 255), unsigned(2310, 2), V, -1),
+            entry((1, 0, 31, 7, 0, 255), unsigned(117, 2), A, -2),
+            entry((1, 0, 14, 7, 0, 255), unsigned(4998, 2), HZ, -2),
+        ], sensor_time=5000),
+        close_response())
+
+
+def minimal():
+    """Short push message as sent by meters in a fast mode"""
+    return frame(get_list_response(SERVER_ID, [entry((1, 0, 16, 7, 0, 255), integer(4512, 4), W, 0)]))
+
+
+def escaped():
+    """Contains the escape sequence within an octet string, which is escaped by the transport"""
+    return frame(get_list_response(SERVER_ID, [
+        entry((1, 0, 96, 50, 1, 1), octets(b"\x00\x1b\x1b\x1b\x1b\x1b\x1b\x1b\x1b\x01\x01\x01\x01\x1a")),
+        entry((1, 0, 1, 8, 0, 255), unsigned(35462459, 4), WH, -1),
+    ]))
+
+
+def mixed_types():
+    return frame(
+        open_response(SERVER_ID),
+        get_list_response(SERVER_ID, [
+            entry((1, 0, 96, 90, 2, 1), boolean(True)),
+            entry((1, 0, 97, 97, 0, 255), boolean(False)),
+            entry((1, 0, 16, 7, 0, 255), integer(-128, 1), W, 3),
+            entry((1, 0, 2, 8, 0, 255), unsigned(2 ** 64 - 1, 8), WH, -9),
+            entry((1, 0, 96, 1, 0, 255), octets(b"1EMH0012345678")),
+            entry((1, 0, 96, 5, 0, 255), unsigned(0x1234, 2), None, None),
+        ]),
+        close_response())
+
+
+def many_values():
+    """More values than a snapshot keeps per sensor"""
+    return frame(get_list_response(SERVER_ID, [
+        entry((1, 0, 1, 8, tariff, 255), unsigned(1000 * tariff, 4), WH, -1) for tariff in range(20)
+    ]))
+
+
+SEEDS = {
+    "basic": basic,
+    "high_resolution": high_resolution,
+    "minimal": minimal,
+    "escaped": escaped,
+    "mixed_types": mixed_types,
+    "many_values": many_values,
+}
+
+
+if __name__ == "__main__":
+    if len(sys.argv) != 2:
+        print(__doc__)
+        sys.exit(1)
+    os.makedirs(sys.argv[1], exist_ok=True)
+    for name, build in SEEDS.items():
+        with open(os.path.join(sys.argv[1], name + ".bin"), "wb") as f:
+            f.write(build())
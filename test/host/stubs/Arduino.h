@@ -0,0 +1,89 @@
+// Host stand-in for the parts of the ESP8266 Arduino core used by SMLReader.
+// Time is virtual and only advances when the harness calls host_advance().
+#ifndef HOST_ARDUINO_H
+#define HOST_ARDUINO_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <algorithm>
+#include <functional>
+#include <memory>
+#include <string>
+
+typedef uint8_t byte;
+using std::max;
+using std::min;
+
+#define PROGMEM
+#define F(s) (s)
+#define pgm_read_byte(addr) (*(const uint8_t *)(addr))
+#define strncpy_P strncpy
+
+#define D2 4
+#define LED_BUILTIN 2
+
+inline uint64_t &host_micros()
+{
+    static uint64_t micros = 0;
+    return micros;
+}
+
+inline void host_advance(uint64_t micros)
+{
+    host_micros() += micros;
+}
+
+inline unsigned long millis()
+{
+    return (unsigned long)(host_micros() / 1000);
+}
+
+inline void yield()
+{
+}
+
+inline void delay(unsigned long ms)
+{
+    host_advance(ms * 1000ULL);
+}
+
+class String
+{
+public:
+    String(const char *str = "") : str(str) {}
+    const char *c_str() const { return this->str.c_str(); }
+
+private:
+    std::string str;
+};
+
+class IPAddress
+{
+public:
+    IPAddress(uint8_t a = 0, uint8_t b = 0, uint8_t c = 0, uint8_t d = 0) : a(a), b(b), c(c), d(d) {}
+    String toString() const
+    {
+        char buffer[16];
+        snprintf(buffer, sizeof(buffer), "%u.%u.%u.%u", this->a, this->b, this->c, this->d);
+        return String(buffer);
+    }
+
+private:
+    uint8_t a, b, c, d;
+};
+
+class EspClass
+{
+public:
+    uint32_t getFreeHeap() { return 40000; }
+    uint16_t getMaxFreeBlockSize() { return 30000; }
+    uint32_t getChipId() { return 0xC7551E; }
+};
+
+static EspClass ESP;
+
+#endif
@@ -0,0 +1,17 @@
+// Host stand-in for the ESP8266 WiFi interface, always connected
+#ifndef HOST_ESP8266_WIFI_H
+#define HOST_ESP8266_WIFI_H
+
+#include "Arduino.h"
+
+class ESP8266WiFiClass
+{
+public:
+    bool isConnected() { return true; }
+    IPAddress localIP() { return IPAddress(192, 168, 1, 2); }
+    int32_t RSSI() { return -67; }
+};
+
+static ESP8266WiFiClass WiFi;
+
+#endif
@@ -0,0 +1,97 @@
+// Host stand-in for ESPAsyncTCP.
+// The harness can connect a client to the most recently started server via AsyncServer::connect_client().
+#ifndef HOST_ESP_ASYNC_TCP_H
+#define HOST_ESP_ASYNC_TCP_H
+
+#include "Arduino.h"
+
+class AsyncClient
+{
+public:
+    typedef std::function<void(void *, AsyncClient *, void *, size_t)> DataHandler;
+    typedef std::function<void(void *, AsyncClient *)> DisconnectHandler;
+
+    bool canSend() { return true; }
+    size_t space() { return 5744; }
+    size_t add(const char *data, size_t len)
+    {
+        for (size_t i = 0; i < len; i++)
+        {
+            this->checksum = this->checksum * 31 + (uint8_t)data[i];
+        }
+        this->sent += len;
+        return len;
+    }
+    bool send() { return true; }
+    void setNoDelay(bool noDelay) {}
+    IPAddress remoteIP() { return IPAddress(192, 168, 1, 3); }
+    void onData(DataHandler handler, void *arg) { this->dataHandler = handler; }
+    void onDisconnect(DisconnectHandler handler, void *arg) { this->disconnectHandler = handler; }
+
+    void close(bool now)
+    {
+        if (this->disconnectHandler)
+        {
+            // The handler may delete the client
+            DisconnectHandler handler = this->disconnectHandler;
+            handler(NULL, this);
+        }
+    }
+
+    // Host side: passes data received from the remote end to the handler
+    void receive(const char *data, size_t len)
+    {
+        if (this->dataHandler)
+        {
+            this->dataHandler(NULL, this, (void *)data, len);
+        }
+    }
+
+    size_t sent = 0;
+    uint32_t checksum = 0;
+
+private:
+    DataHandler dataHandler;
+    DisconnectHandler disconnectHandler;
+};
+
+class AsyncServer
+{
+public:
+    typedef std::function<void(void *, AsyncClient *)> ClientHandler;
+
+    AsyncServer(uint16_t port) {}
+    ~AsyncServer()
+    {
+        if (started() == this)
+        {
+            started() = NULL;
+        }
+    }
+    void onClient(ClientHandler handler, void *arg) { this->clientHandler = handler; }
+    void setNoDelay(bool noDelay) {}
+    void begin() { started() = this; }
+
+    // Host side: connects a new client to the most recently started server, which takes ownership of it
+    static AsyncClient *connect_client()
+    {
+        if (started() == NULL || !started()->clientHandler)
+        {
+            return NULL;
+        }
+        AsyncClient *client = new AsyncClient();
+        started()->clientHandler(NULL, client);
+        return client;
+    }
+
+private:
+    ClientHandler clientHandler;
+
+    static AsyncServer *&started()
+    {
+        static AsyncServer *server = NULL;
+        return server;
+    }
+};
+
+#endif
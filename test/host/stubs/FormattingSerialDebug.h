@@ -0,0 +1,8 @@
+// Host stand-in for MicroDebug, logging is disabled
+#ifndef HOST_FORMATTING_SERIAL_DEBUG_H
+#define HOST_FORMATTING_SERIAL_DEBUG_H
+
+#define DEBUG(...)
+#define SERIAL_DEBUG_SETUP(...)
+
+#endif
@@ -0,0 +1,141 @@
+// Host stand-in for EspSoftwareSerial.
+// Bytes are put on the line with a time of arrival and moved into the receive buffer
+// once the virtual clock has passed it, like the receive interrupt does on the device.
+// Bytes arriving while the buffer is full are lost and flagged by overflow().
+#ifndef HOST_SOFTWARE_SERIAL_H
+#define HOST_SOFTWARE_SERIAL_H
+
+#include "Arduino.h"
+#include <deque>
+#include <map>
+
+#define SWSERIAL_8N1 0
+
+class SoftwareSerial
+{
+public:
+    ~SoftwareSerial()
+    {
+        if (registry()[this->rx] == this)
+        {
+            registry().erase(this->rx);
+        }
+    }
+
+    void begin(uint32_t baud, int config, int8_t rx, int8_t tx, bool invert, int capacity)
+    {
+        this->baud = baud;
+        this->rx = rx;
+        this->capacity = capacity;
+        registry()[rx] = this;
+    }
+
+    void enableTx(bool enable) {}
+    void enableRx(bool enable) {}
+
+    int available()
+    {
+        this->receive();
+        return this->buffer.size();
+    }
+
+    int read()
+    {
+        this->receive();
+        if (this->buffer.empty())
+        {
+            return -1;
+        }
+        uint8_t data = this->buffer.front();
+        this->buffer.pop_front();
+        return data;
+    }
+
+    bool overflow()
+    {
+        bool overflow = this->overflowed;
+        this->overflowed = false;
+        return overflow;
+    }
+
+    // Host side: sends the data with the configured baud rate (10 bits per byte), starting at the given time
+    uint64_t transmit(const uint8_t *data, size_t len, uint64_t start)
+    {
+        uint64_t time = std::max(start, this->line_free);
+        for (size_t i = 0; i < len; i++)
+        {
+            time += 10000000ULL / this->baud;
+            this->line.push_back(std::make_pair(time, data[i]));
+        }
+        this->line_free = time;
+        return time;
+    }
+
+    // Host side: whether all bytes sent have been read
+    bool idle()
+    {
+        this->receive();
+        return this->line.empty() && this->buffer.empty();
+    }
+
+    // Host side: the time the last byte sent arrives
+    uint64_t line_free_at() const
+    {
+        return this->line_free;
+    }
+
+    // Host side: the largest number of bytes waiting in the receive buffer
+    size_t peak() const
+    {
+        return this->buffer_peak;
+    }
+
+    // Host side: number of bytes lost due to a full receive buffer
+    size_t lost() const
+    {
+        return this->bytes_lost;
+    }
+
+    static SoftwareSerial *on_pin(int8_t rx)
+    {
+        std::map<int8_t, SoftwareSerial *>::iterator it = registry().find(rx);
+        return it == registry().end() ? NULL : it->second;
+    }
+
+private:
+    uint32_t baud = 9600;
+    int8_t rx = -1;
+    size_t capacity = 64;
+    bool overflowed = false;
+    uint64_t line_free = 0;
+    size_t buffer_peak = 0;
+    size_t bytes_lost = 0;
+    std::deque<std::pair<uint64_t, uint8_t>> line;
+    std::deque<uint8_t> buffer;
+
+    void receive()
+    {
+        while (!this->line.empty() && this->line.front().first <= host_micros())
+        {
+            if (this->buffer.size() < this->capacity)
+            {
+                this->buffer.push_back(this->line.front().second);
+                this->buffer_peak = std::max(this->buffer_peak, this->buffer.size());
+            }
+            else
+            {
+                this->overflowed = true;
+                this->bytes_lost++;
+            }
+            this->line.pop_front();
+        }
+    }
+
+    static std::map<int8_t, SoftwareSerial *> &registry()
+    {
+        static std::map<int8_t, SoftwareSerial *> serials;
+        return serials;
+    }
+};
+
+#endif
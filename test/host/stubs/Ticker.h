@@ -0,0 +1,15 @@
+// Host stand-in for Ticker, callbacks are never invoked
+#ifndef HOST_TICKER_H
+#define HOST_TICKER_H
+
+#include "Arduino.h"
+
+class Ticker
+{
+public:
+    void attach(float seconds, std::function<void()> callback) {}
+    void attach_ms(uint32_t ms, std::function<void()> callback) {}
+    void detach() {}
+};
+
+#endif
@@ -0,0 +1,27 @@
+// Host stand-in for WiFiUDP, discards sent packets and never receives any
+#ifndef HOST_WIFI_UDP_H
+#define HOST_WIFI_UDP_H
+
+#include "Arduino.h"
+
+class WiFiUDP
+{
+public:
+    uint8_t begin(uint16_t port) { return 1; }
+    int parsePacket() { return 0; }
+    int read(char *buffer, size_t len) { return 0; }
+    IPAddress remoteIP() { return IPAddress(); }
+    uint16_t remotePort() { return 0; }
+    int beginPacket(IPAddress ip, uint16_t port) { return 1; }
+    int beginPacketMulticast(IPAddress ip, uint16_t port, IPAddress interfaceAddress) { return 1; }
+    size_t write(const uint8_t *buffer, size_t len)
+    {
+        this->sent += len;
+        return len;
+    }
+    int endPacket() { return 1; }
+
+    size_t sent = 0;
+};
+
+#endif
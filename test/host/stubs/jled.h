@@ -0,0 +1,26 @@
+// Host stand-in for JLed
+#ifndef HOST_JLED_H
+#define HOST_JLED_H
+
+#include "Arduino.h"
+
+class JLed
+{
+public:
+    JLed(uint8_t pin) {}
+    JLed &Blink(uint16_t on, uint16_t off) { this->active = true; return *this; }
+    JLed &Repeat(uint16_t count) { return *this; }
+    JLed &DelayAfter(uint16_t delay) { return *this; }
+    JLed &LowActive() { return *this; }
+    bool Update()
+    {
+        bool active = this->active;
+        this->active = false;
+        return active;
+    }
+
+private:
+    bool active = false;
+};
+
+#endif